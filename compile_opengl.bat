@@ -17,7 +17,7 @@ if not exist glad\include\glad\gl.h (
 
 REM Compilation
 echo Compiling...
-g++ main.cpp -Iglad/include -I"C:\vcpkg/installed/x64-windows/include" glad/src/gl.c -L"C:\vcpkg/installed/x64-windows/lib" -lglfw3dll -lgdi32 -lopengl32 -o securebox.exe
+g++ main.cpp fixed_box.cpp -Iglad/include -I"C:\vcpkg/installed/x64-windows/include" glad/src/gl.c -L"C:\vcpkg/installed/x64-windows/lib" -lglfw3dll -lgdi32 -lopengl32 -o securebox.exe
 
 if %ERRORLEVEL% NEQ 0 (
     echo Compilation error!
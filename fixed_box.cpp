@@ -0,0 +1,70 @@
+#include "fixed_box.h"
+
+#include <chrono>
+
+#include "securebox/fixed_closed_form.h"
+#include "securebox/secure_box_fixed.h"
+
+//================================================================================
+// Function: solveFixedBox
+// Description:
+//     The size-independent half of openFixedBox: reads the target -s off
+//     the bit planes of the box into a stack array and solves it with
+//     solveFixedClosedForm into times, W·H toggle counts the template
+//     replays. Kept out of the template so the FIXED_BOX_MAX_SIZE²
+//     instantiations only hold the register-resident toggles.
+//================================================================================
+bool solveFixedBox(uint32_t width, uint32_t height, const uint64_t *ones, const uint64_t *twos, int *times)
+{
+    int target[FIXED_BOX_MAX_SIZE * FIXED_BOX_MAX_SIZE];
+    size_t cells = static_cast<size_t>(width) * height;
+    for (size_t cell = 0; cell < cells; ++cell)
+    {
+        uint64_t bit = uint64_t(1) << (cell & 63);
+        target[cell] = (ones[cell >> 6] & bit) ? 2 : (twos[cell >> 6] & bit) ? 1 : 0;
+    }
+    return solveFixedClosedForm(width, height, target, times);
+}
+
+//================================================================================
+// Function: openFixedBox
+// Description:
+//     openFixedBoxHeadless for one compile-time size.
+//================================================================================
+template <uint32_t W, uint32_t H>
+FixedBoxRun openFixedBox(SecureBoxFixed<W, H> &box)
+{
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+
+    FixedBoxRun run;
+    int times[W * H];
+    run.solvable = solveFixedBox(W, H, box.onesPlane(), box.twosPlane(), times);
+    if (!run.solvable)
+        return run;
+    auto solved = Clock::now();
+
+    for (uint32_t cell = 0; cell < W * H; ++cell)
+        for (int t = 0; t < times[cell]; ++t, ++run.toggles)
+            box.toggle(cell % W, cell / W);
+    auto applied = Clock::now();
+
+    run.solveMilliseconds = std::chrono::duration<double, std::milli>(solved - start).count();
+    run.applyMilliseconds = std::chrono::duration<double, std::milli>(applied - solved).count();
+    run.opened = !box.isLocked();
+    return run;
+}
+
+//================================================================================
+// Function: openFixedBoxHeadless
+// Description:
+//     Picks the openFixedBox instantiation of the size from the dispatch
+//     table, with a freshly shuffled box.
+//================================================================================
+FixedBoxRun openFixedBoxHeadless(uint32_t width, uint32_t height)
+{
+    return dispatchFixedBox(width, height, [](auto size) {
+        typename decltype(size)::Box box;
+        return openFixedBox(box);
+    });
+}
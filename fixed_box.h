@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+//================================================================================
+// Struct: FixedBoxRun
+// Description:
+//     Outcome of openFixedBoxHeadless: whether the box was solvable and
+//     ended up open, how many toggles were replayed and how long the solve
+//     and the replay took.
+//================================================================================
+struct FixedBoxRun
+{
+    bool solvable = false;
+    bool opened = false;
+    uint32_t toggles = 0;
+    double solveMilliseconds = 0;
+    double applyMilliseconds = 0;
+};
+
+//================================================================================
+// Function: openFixedBoxHeadless
+// Description:
+//     Shuffles a SecureBoxFixed of the given size (1..FIXED_BOX_MAX_SIZE on
+//     both sides), solves it and replays the toggles with its
+//     register-resident toggle(). Lives in fixed_box.cpp, so the
+//     FIXED_BOX_MAX_SIZE² instantiations behind it are compiled once, apart
+//     from main.cpp.
+//================================================================================
+FixedBoxRun openFixedBoxHeadless(uint32_t width, uint32_t height);
@@ -1,19 +1,31 @@
 #include <iostream>
 #include <vector>
-#include <random>
-#include <time.h>
 #include <iomanip>
 #include <cstdlib>
 #include <string>
+#include <sstream>
 #include <thread>
 #include <chrono>
 #include <array>
 #include <algorithm>
+#include <fstream>
+#include <new>
 
 // OpenGL headers
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
+#include "fixed_box.h"
+#include "securebox/closed_form_solver.h"
+#include "securebox/incremental_solver.h"
+#include "securebox/lazy_storage.h"
+#include "securebox/mapped_storage.h"
+#include "securebox/min_toggle_search.h"
+#include "securebox/secure_box.h"
+#include "securebox/secure_box_fixed.h"
+#include "securebox/solver_registry.h"
+#include "securebox/tiled_storage.h"
+
 //===========================================================================
 // # PROBLEM: Total Unlocking of the SecureBox
 //===========================================================================
@@ -39,178 +51,19 @@
 //     Returns true if at least one cell is non-zero (locked or partially locked).
 //     Returns false only when all cells are 0 (unlocked).
 //
+// StateView view()
+//     Returns a read-only view of the current box state (row(y), at(x, y),
+//     data() + stride()). Valid until the next toggle.
+//
 // std::vector<std::vector<uint8_t>> getState()
 //     Returns a copy of the current box state (2D grid of values).
+//
+// uint64_t lockedCount(), std::array<uint64_t, 3> histogram()
+//     Number of non-zero cells and number of cells per value, kept up to date
+//     incrementally by every toggle.
 // 
 //================================================================================
 
-//================================================================================
-// Class: SecureBox
-// Description:
-//     Represents a 2D grid of integer states:
-//         0 = fully unlocked
-//         1 = partially locked
-//         2 = fully locked
-//================================================================================
-class SecureBox
-{
-private:
-    std::vector<std::vector<uint8_t>> box;
-    std::mt19937_64 rng;
-    uint32_t xSize, ySize;
-
-public:
-
-    //================================================================================
-    // Constructor: SecureBox
-    // Description:
-    //     Initializes the box with dimensions x × y and randomizes the grid
-    //     using pseudo-random toggle operations.
-    //================================================================================
-    SecureBox(uint32_t x, uint32_t y) : xSize(x), ySize(y)
-    {
-        rng.seed(time(0));
-        box.resize(y);
-        for (auto &row : box)
-            row.resize(x, 0);
-        shuffle();
-    }
-
-    //================================================================================
-    // Method: toggle
-    // Description:
-    //     Applies modulo-3 increment to:
-    //         - all cells in column x (↑↓)
-    //         - all cells in row y (←→)
-    //         - compensates the (x, y) cell by incrementing it again (+2 mod 3)
-    //================================================================================
-    void toggle(uint32_t x, uint32_t y)
-    {
-        // Vertical (column)
-        for (uint32_t row = 0; row < ySize; ++row)
-            box[row][x] = (box[row][x] + 1) % 3;
-
-        // Horizontal (row)
-        for (uint32_t col = 0; col < xSize; ++col)
-            box[y][col] = (box[y][col] + 1) % 3;
-
-        // Center cell was incremented twice, fix it to be +1 total
-        box[y][x] = (box[y][x] + 2) % 3;
-    }
-
-    //================================================================================
-    // Method: isLocked
-    // Description:
-    //     Returns true if any cell is not 0 (i.e. locked or partially locked).
-    //     Returns false only if all cells are fully unlocked (0).
-    //================================================================================
-    bool isLocked() const
-    {
-        for (const auto &row : box)
-            for (uint8_t cell : row)
-                if (cell != 0)
-                    return true;
-        return false;
-    }
-
-    //================================================================================
-    // Method: getState
-    // Description:
-    //     Returns a deep copy of the current grid state.
-    //================================================================================
-    std::vector<std::vector<uint8_t>> getState() const
-    {
-        return box;
-    }
-
-    uint32_t getWidth() const { return xSize; }
-    uint32_t getHeight() const { return ySize; }
-
-private:
-
-    //================================================================================
-    // Method: shuffle
-    // Description:
-    //     Randomly toggles cells multiple times to generate
-    //     a scrambled starting configuration.
-    //================================================================================
-    void shuffle()
-    {
-        for (uint32_t t = rng() % 0x1000; t > 0; --t)
-            toggle(rng() % xSize, rng() % ySize);
-    }
-};
-
-int modInverse(int a, int mod)
-{
-    for (int i = 1; i < mod; ++i)
-        if ((a * i) % mod == 1)
-            return i;
-    return 1;
-}
-
-std::vector<int> solveLinearSystem(std::vector<std::vector<int>> matrix, std::vector<int> target)
-{
-    int n = matrix.size();
-    int m = matrix[0].size();
-
-    for (int i = 0; i < n; ++i)
-        matrix[i].push_back(target[i]);
-
-    // Gaussian elimination
-    for (int col = 0, row = 0; col < m && row < n; ++col)
-    {
-        int pivot = -1;
-        for (int i = row; i < n; ++i)
-        {
-            if (matrix[i][col] != 0)
-            {
-                pivot = i;
-                break;
-            }
-        }
-
-        if (pivot == -1)
-            continue;
-
-        if (pivot != row)
-            std::swap(matrix[pivot], matrix[row]);
-
-        // Make pivot 1
-        int pivotVal = matrix[row][col];
-        int inv = modInverse(pivotVal, 3);
-        for (int j = col; j <= m; ++j)
-            matrix[row][j] = (matrix[row][j] * inv) % 3;
-
-        // Eliminate column
-        for (int i = 0; i < n; ++i)
-        {
-            if (i != row && matrix[i][col] != 0)
-            {
-                int factor = matrix[i][col];
-                for (int j = col; j <= m; ++j)
-                    matrix[i][j] = (matrix[i][j] - factor * matrix[row][j] + 9) % 3; // mod can be negative so add 9 to guarantee positive result
-            }
-        }
-        row++;
-    }
-
-    std::vector<int> solution(m, 0);
-    for (int i = 0; i < std::min(n, m); ++i)
-    {
-        for (int j = 0; j < m; ++j)
-        {
-            if (matrix[i][j] == 1)
-            {
-                solution[j] = matrix[i][m];
-                break;
-            }
-        }
-    }
-
-    return solution;
-}
-
 //================================================================================
 // Console fallback implementation
 //================================================================================
@@ -232,9 +85,10 @@ const std::string WHITE = "\033[37m";
 const std::string BOLD = "\033[1m";
 const std::string RESET = "\033[0m";
 
-void displayBoxConsole(const SecureBox &box, const std::string &title = "SecureBox State")
+template <typename Storage>
+void displayBoxConsole(const SecureBox<Storage> &box, const std::string &title = "SecureBox State")
 {
-    auto state = box.getState();
+    StateView state = box.view();
 
     std::cout << BOLD << CYAN << "\n"
               << title << RESET << "\n";
@@ -250,7 +104,7 @@ void displayBoxConsole(const SecureBox &box, const std::string &title = "SecureB
         std::cout << std::setw(2) << y << " ";
         for (uint32_t x = 0; x < box.getWidth(); ++x)
         {
-            int value = static_cast<int>(state[y][x]);
+            int value = static_cast<int>(state.at(x, y));
 
             if (value == 0)
                 std::cout << GREEN << "[" << value << "]" << RESET;
@@ -267,7 +121,12 @@ void displayBoxConsole(const SecureBox &box, const std::string &title = "SecureB
               << " " << RED << "[2]=Locked" << RESET << "\n";
 
     if (box.isLocked())
-        std::cout << "Status: " << RED << "LOCKED" << RESET << "\n\n";
+    {
+        auto counts = box.histogram();
+        std::cout << "Status: " << RED << "LOCKED" << RESET << " (" << box.lockedCount() << " of "
+                  << (counts[0] + counts[1] + counts[2]) << " cells: " << counts[1] << " partial, "
+                  << counts[2] << " locked)\n\n";
+    }
     else
         std::cout << "Status: " << GREEN << "UNLOCKED" << RESET << "\n\n";
 }
@@ -298,6 +157,7 @@ private:
     std::vector<std::vector<uint8_t>> currentBoxState;
     std::vector<std::vector<float>> targetHeights;
     std::vector<std::vector<float>> currentHeights;
+    std::vector<float> textureData; // RGB upload buffer, reused between frames
     
     struct AnimationEffect {
         int step;
@@ -708,9 +568,14 @@ public:
         return true;
     }
 
-    void updateBoxState(const SecureBox &box)
+    template <typename Storage>
+    void updateBoxState(const SecureBox<Storage> &box)
     {
-        currentBoxState = box.getState();
+        // Refill the existing rows from the view, no reallocation after the first frame
+        StateView state = box.view();
+        currentBoxState.resize(state.height());
+        for (uint32_t y = 0; y < state.height(); ++y)
+            currentBoxState[y].assign(state.row(y), state.row(y) + state.width());
         
         if (targetHeights.empty()) {
             targetHeights.resize(currentBoxState.size());
@@ -837,7 +702,7 @@ private:
         int width = currentHeights[0].size();
         int height = currentHeights.size();
         
-        std::vector<float> textureData(width * height * 3); // RGB
+        textureData.resize(width * height * 3); // RGB
         
         for (int y = 0; y < height; ++y) {
             for (int x = 0; x < width; ++x) {
@@ -962,17 +827,110 @@ private:
     }
 };
 
+//================================================================================
+// Function: buildTarget
+// Description:
+//     Returns how much has to be added to every cell (row-major) to reach 0.
+//================================================================================
+template <typename Storage>
+std::vector<int> buildTarget(const SecureBox<Storage> &box)
+{
+    uint32_t width = box.getWidth();
+    uint32_t height = box.getHeight();
+
+    StateView currentState = box.view();
+    std::vector<int> target(static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            size_t index = static_cast<size_t>(y) * width + x;
+            target[index] = (-currentState.at(x, y) + 3) % 3;
+        }
+    }
+    return target;
+}
+
+//================================================================================
+// Function: openBoxHeadless
+// Description:
+//     Solves the box from its row and column sums and applies the whole
+//     solution in one pass, without any interaction. Never builds the target
+//     or a move list, so memory stays O(W + H) on top of the grid. Used for
+//     batch runs and large boxes.
+//================================================================================
+template <typename Storage>
+bool openBoxHeadless(SecureBox<Storage> &box)
+{
+    uint32_t width = box.getWidth();
+    uint32_t height = box.getHeight();
+
+    auto start = std::chrono::steady_clock::now();
+
+    // The target is -state, and so are its row and column sums
+    std::vector<int> rowSum, colSum;
+    box.lineSums(rowSum, colSum);
+    std::vector<int> rowTarget(height), colTarget(width);
+    for (uint32_t y = 0; y < height; ++y)
+        rowTarget[y] = (3 - rowSum[y]) % 3;
+    for (uint32_t x = 0; x < width; ++x)
+        colTarget[x] = (3 - colSum[x]) % 3;
+
+    LineSolution result = solveClosedFormLines(width, height, rowTarget, colTarget);
+    if (!result.solvable)
+    {
+        std::cout << RED << "No toggle sequence can unlock this box!" << RESET << std::endl;
+        return false;
+    }
+    auto solved = std::chrono::steady_clock::now();
+
+    box.applyLineSolution(result.rowTotal, result.colTotal, rowSum, colSum);
+    auto applied = std::chrono::steady_clock::now();
+
+    std::cout << "Solved in " << std::chrono::duration<double, std::milli>(solved - start).count() << " ms, "
+              << "applied in " << std::chrono::duration<double, std::milli>(applied - solved).count() << " ms" << std::endl;
+
+    return !box.isLocked();
+}
+
+// Branch-and-bound nodes spent on finding the cheapest of several solutions,
+// about half a second for the largest interactive boxes
+const uint64_t MIN_TOGGLE_SEARCH_NODES = 1u << 20;
+
+// Solver backends openBox chooses from, with the cost profile, memory
+// budget and thread count set up by main()
+SolverRegistry solverRegistry;
+uint64_t solverMemoryBudget = DEFAULT_SOLVER_MEMORY_BUDGET;
+unsigned solverThreads = 0;
+
+//================================================================================
+// Function: remainingMoves
+// Description:
+//     The toggles a plan still needs, one move per cell, for a batched
+//     SecureBox::applyMoves.
+//================================================================================
+std::vector<Move> remainingMoves(const IncrementalSolver &plan)
+{
+    std::vector<Move> moves;
+    const std::vector<uint8_t> &counts = plan.solution();
+    for (uint32_t y = 0; y < plan.height(); ++y)
+        for (uint32_t x = 0; x < plan.width(); ++x)
+            if (uint8_t count = counts[static_cast<size_t>(y) * plan.width() + x])
+                moves.push_back({static_cast<int>(x), static_cast<int>(y), count});
+    return moves;
+}
+
 //================================================================================
 // Function: openBox
 // Description:
 //     Opens the SecureBox and allows the user to interact with it.
 //     Always shows console output, with optional OpenGL visualization for comparison.
 //================================================================================
-bool openBox(SecureBox &box, bool useOpenGL)
+template <typename Storage>
+bool openBox(SecureBox<Storage> &box, bool useOpenGL)
 {
     uint32_t width = box.getWidth();
     uint32_t height = box.getHeight();
-    int totalCells = width * height;
 
     OpenGLRenderer* renderer = nullptr;
     
@@ -1012,64 +970,57 @@ bool openBox(SecureBox &box, bool useOpenGL)
         waitForEnter("Press Enter to start solving...");
     }
 
-    std::vector<std::vector<int>> effectMatrix(totalCells, std::vector<int>(totalCells, 0));
+    std::vector<int> target = buildTarget(box);
 
-    for (int toggleY = 0; toggleY < height; ++toggleY)
+    // The registry picks the backend, the log shows why and what it expected
+    SolverQuery query{width, height, nullptr, solverMemoryBudget, &std::cout, solverThreads};
+    SolverChoice choice = solverRegistry.select(query);
+    std::cout << "\nSolver candidates (" << solverRegistry.profileSource() << "):" << std::endl;
+    std::cout << solverRegistry.describe(choice);
+    if (!choice.backend)
     {
-        for (int toggleX = 0; toggleX < width; ++toggleX)
-        {
-            int toggleIndex = toggleY * width + toggleX;
-
-            for (int y = 0; y < height; ++y)
-            {
-                int cellIndex = y * width + toggleX;
-                effectMatrix[cellIndex][toggleIndex] = (effectMatrix[cellIndex][toggleIndex] + 1) % 3;
-            }
-
-            for (int x = 0; x < width; ++x)
-            {
-                int cellIndex = toggleY * width + x;
-                effectMatrix[cellIndex][toggleIndex] = (effectMatrix[cellIndex][toggleIndex] + 1) % 3;
-            }
-
-            int centerIndex = toggleY * width + toggleX;
-            effectMatrix[centerIndex][toggleIndex] = (effectMatrix[centerIndex][toggleIndex] + 2) % 3;
+        std::cout << RED << "No solver fits the memory budget of " << solver_registry_detail::formatBytes(solverMemoryBudget)
+                  << "!" << RESET << std::endl;
+        if (renderer) {
+            renderer->cleanup();
+            delete renderer;
         }
+        return false;
     }
 
-    auto currentState = box.getState();
-    std::vector<int> target(totalCells);
-    for (int y = 0; y < height; ++y)
+    std::cout << "Solving linear system with " << choice.backend->name << "..." << std::endl;
+    auto solveStart = std::chrono::steady_clock::now();
+    SolveResult result = choice.backend->solve(query, target);
+    double solveSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - solveStart).count();
+    std::cout << "Solved in " << solver_registry_detail::formatSeconds(solveSeconds) << " (predicted "
+              << solver_registry_detail::formatSeconds(choice.predictedSeconds) << " warm)" << std::endl;
+
+    if (!result.solvable)
     {
-        for (int x = 0; x < width; ++x)
-        {
-            int index = y * width + x;
-            target[index] = (-currentState[y][x] + 3) % 3;
+        std::cout << RED << "No toggle sequence can unlock this box!" << RESET << std::endl;
+        if (renderer) {
+            renderer->cleanup();
+            delete renderer;
         }
+        return false;
     }
 
-    std::cout << "\nSolving linear system..." << std::endl;
-    std::vector<int> solution = solveLinearSystem(effectMatrix, target);
-
-    // Collect all moves
-    struct Move {
-        int x, y, count;
-    };
-    std::vector<Move> moves;
-    
-    for (int y = 0; y < height; ++y)
+    if (result.nullity > 0)
     {
-        for (int x = 0; x < width; ++x)
-        {
-            int index = y * width + x;
-            int toggleCount = solution[index];
-            if (toggleCount > 0) {
-                moves.push_back({x, y, toggleCount});
-            }
-        }
+        // Every solution unlocks the box, replay the one with the fewest toggles
+        if (!result.nullspace)
+            result.nullspace = closedFormNullspace(width, height);
+        ToggleSearchResult cheapest = minimizeToggles(result, MIN_TOGGLE_SEARCH_NODES);
+        std::cout << "Grid has 3^" << result.nullity << " equivalent solutions, using "
+                  << (cheapest.optimal ? "the cheapest" : "the cheapest found") << " with " << cheapest.toggles
+                  << " toggles" << std::endl;
+        result.solution = cheapest.solution;
     }
 
-    if (moves.empty())
+    // The plan follows the box: external toggles update it in O(1)
+    IncrementalSolver plan(width, height, result.solution);
+
+    if (plan.solved())
     {
         std::cout << "Box was already unlocked or solution requires no moves!" << std::endl;
         if (renderer) {
@@ -1081,8 +1032,7 @@ bool openBox(SecureBox &box, bool useOpenGL)
     }
 
     int step = 1;
-    size_t currentMove = 0;
-    int currentToggleCount = 0;
+    Move move;
 
     if (useOpenGL && renderer)
     {
@@ -1092,21 +1042,16 @@ bool openBox(SecureBox &box, bool useOpenGL)
         std::cout << "Press SPACE in OpenGL window to apply next toggle" << std::endl;
         std::cout << std::string(50, '=') << std::endl;
         
-        while (currentMove < moves.size() && !renderer->shouldCloseWindow())
+        while (plan.nextMove(move) && !renderer->shouldCloseWindow())
         {
-            if (currentMove < moves.size()) {
-                renderer->setNextMove(moves[currentMove].x, moves[currentMove].y);
-            }
-            
+            renderer->setNextMove(move.x, move.y);
             renderer->renderFrame();
             
             if (renderer->checkSpacePressed())
             {
-                auto& move = moves[currentMove];
-                
                 clearScreen();
                 std::cout << BOLD << YELLOW << "Step " << step << ": Applying Toggle(" << move.x << ", " << move.y << ")" << RESET << std::endl;
-                std::cout << "Move " << (currentMove + 1) << " of " << moves.size() << std::endl;
+                std::cout << plan.remaining() << " toggles left" << std::endl;
                 std::cout << std::string(50, '-') << std::endl;
                 
                 displayBoxConsole(box, "State BEFORE Toggle");
@@ -1114,6 +1059,7 @@ bool openBox(SecureBox &box, bool useOpenGL)
                 renderer->addAnimationEffect(step, move.x, move.y, 1.5f);
                 
                 box.toggle(move.x, move.y);
+                plan.toggled(move.x, move.y);
                 renderer->updateBoxState(box);
                 
                 displayBoxConsole(box, "State AFTER Toggle");
@@ -1129,12 +1075,6 @@ bool openBox(SecureBox &box, bool useOpenGL)
                 }
                 
                 step++;
-                currentToggleCount++;
-                if (currentToggleCount >= move.count)
-                {
-                    currentMove++;
-                    currentToggleCount = 0;
-                }
                 
                 if (!box.isLocked())
                 {
@@ -1143,9 +1083,7 @@ bool openBox(SecureBox &box, bool useOpenGL)
                 }
             }
             
-            if (currentMove < moves.size()) {
-                renderer->setNextMove(moves[currentMove].x, moves[currentMove].y);
-            } else {
+            if (plan.solved()) {
                 renderer->clearNextMove();
             }
             
@@ -1158,34 +1096,66 @@ bool openBox(SecureBox &box, bool useOpenGL)
         std::cout << "Applying solution step by step..." << std::endl;
         std::cout << std::string(40, '=') << std::endl;
         
-        for (const auto& move : moves)
+        while (plan.nextMove(move))
         {
-            for (int t = 0; t < move.count; ++t)
+            clearScreen();
+            std::cout << BOLD << YELLOW << "Step " << step << ": Applying Toggle(" << move.x << ", " << move.y << ")" << RESET << std::endl;
+            std::cout << plan.remaining() << " toggles left" << std::endl;
+            std::cout << std::string(50, '-') << std::endl;
+            
+            displayBoxConsole(box, "State BEFORE Toggle");
+            
+            box.toggle(move.x, move.y);
+            plan.toggled(move.x, move.y);
+            
+            displayBoxConsole(box, "State AFTER Toggle");
+
+            if (!box.isLocked())
             {
-                clearScreen();
-                std::cout << BOLD << YELLOW << "Step " << step << ": Applying Toggle(" << move.x << ", " << move.y << ")" << RESET << std::endl;
-                std::cout << "Toggle " << (t + 1) << " of " << move.count << " for this position" << std::endl;
-                std::cout << std::string(50, '-') << std::endl;
-                
-                displayBoxConsole(box, "State BEFORE Toggle");
-                
-                box.toggle(move.x, move.y);
-                
-                displayBoxConsole(box, "State AFTER Toggle");
+                std::cout << BOLD << GREEN << "\nSUCCESS! Box is now unlocked!" << RESET << std::endl;
+                waitForEnter("Press Enter to finish...");
+                break;
+            }
 
-                if (box.isLocked())
+            // "x y" toggles that cell outside the plan, which adapts to it;
+            // "all" applies the rest of the plan in one batch
+            std::cout << CYAN << "Press Enter for next step (or type \"x y\" to toggle a cell yourself, "
+                      << "\"all\" to apply the remaining toggles at once)..." << RESET;
+            std::string line;
+            std::getline(std::cin, line);
+            std::istringstream input(line);
+            int x, y;
+            if (line == "all")
+            {
+                std::vector<Move> moves = remainingMoves(plan);
+                box.applyMoves(moves);
+                for (const auto &batched : moves)
+                    plan.toggled(batched.x, batched.y, batched.count);
+                clearScreen();
+                std::cout << BOLD << YELLOW << "Applied the remaining " << moves.size() << " moves in one pass"
+                          << RESET << std::endl;
+                displayBoxConsole(box, "State AFTER Remaining Toggles");
+                if (!box.isLocked())
                 {
-                    waitForEnter("Press Enter for next step...");
+                    std::cout << BOLD << GREEN << "\nSUCCESS! Box is now unlocked!" << RESET << std::endl;
+                    waitForEnter("Press Enter to finish...");
                 }
-                else
+                break;
+            }
+            else if (input >> x >> y && x >= 0 && y >= 0 && static_cast<uint32_t>(x) < width &&
+                static_cast<uint32_t>(y) < height)
+            {
+                box.toggle(x, y);
+                plan.toggled(x, y);
+                if (!box.isLocked())
                 {
+                    displayBoxConsole(box, "State AFTER Your Toggle");
                     std::cout << BOLD << GREEN << "\nSUCCESS! Box is now unlocked!" << RESET << std::endl;
                     waitForEnter("Press Enter to finish...");
                     break;
                 }
-                step++;
             }
-            if (!box.isLocked()) break;
+            step++;
         }
     }
 
@@ -1198,36 +1168,29 @@ bool openBox(SecureBox &box, bool useOpenGL)
     return !box.isLocked();
 }
 
-int main(int argc, char *argv[])
+//================================================================================
+// Function: runBox
+// Description:
+//     Creates a SecureBox with the requested storage layout, solves it and
+//     prints the final result. Returns the process exit code.
+//================================================================================
+template <typename Storage>
+int runBox(uint32_t x, uint32_t y, bool useOpenGL, bool headless, Storage storage = Storage())
 {
-    if (argc < 3 || argc > 4)
-    {
-        std::cout << "Usage: " << argv[0] << " <width> <height> [--console]" << std::endl;
-        std::cout << "Example: " << argv[0] << " 4 3" << std::endl;
-        std::cout << "         " << argv[0] << " 4 3 --console" << std::endl;
-        std::cout << "\nVisualization modes:" << std::endl;
-        std::cout << "  Default: Dual mode (Console + OpenGL 3D)" << std::endl;
-        std::cout << "  --console: Console only mode" << std::endl;
-        return 1;
-    }
-
-    uint32_t x = std::atol(argv[1]);
-    uint32_t y = std::atol(argv[2]);
-    bool forceConsole = (argc == 4 && std::string(argv[3]) == "--console");
-
-    if (x == 0 || y == 0 || x > 10 || y > 10)
-    {
-        std::cout << "Please use dimensions between 1 and 10." << std::endl;
-        return 1;
-    }
-
-    SecureBox box(x, y);
-    bool useOpenGL = !forceConsole;
+    SecureBox<Storage> box(x, y, std::move(storage));
     
     std::cout << BOLD << CYAN << "SecureBox Solver" << RESET << std::endl;
     std::cout << "Grid size: " << x << "×" << y << std::endl;
+    std::cout << "Storage: " << box.storageName() << " (" << toggleKernels.name << " kernels)" << std::endl;
     
-    if (useOpenGL)
+    if (headless)
+    {
+        std::cout << "Mode: Headless" << std::endl;
+        bool opened = openBoxHeadless(box);
+        std::cout << (opened ? GREEN + "BOX: OPENED!" : RED + "BOX: LOCKED!") << RESET << std::endl;
+        return opened ? 0 : 1;
+    }
+    else if (useOpenGL)
     {
         std::cout << "Mode: Dual visualization (Console + OpenGL)" << std::endl;
         std::cout << "You'll see both console output and 3D visualization for comparison" << std::endl;
@@ -1255,4 +1218,240 @@ int main(int argc, char *argv[])
     }
 
     return state ? 0 : 1;
-}
\ No newline at end of file
+}
+
+//================================================================================
+// Function: runBox
+// Description:
+//     runBox with the storage wrapped in LazyStorage when lazy is set. A box
+//     or solve that does not fit in memory ends with an error instead of an
+//     abort; the in-memory layouts accept sizes that need far more RAM than
+//     most hosts have.
+//================================================================================
+template <typename Storage>
+int runBox(uint32_t x, uint32_t y, bool useOpenGL, bool headless, bool lazy, Storage storage = Storage())
+{
+    try
+    {
+        if (lazy)
+            return runBox<LazyStorage<Storage>>(x, y, useOpenGL, headless, LazyStorage<Storage>(std::move(storage)));
+        return runBox<Storage>(x, y, useOpenGL, headless, std::move(storage));
+    }
+    catch (const std::bad_alloc &)
+    {
+        std::cout << RED << "Out of memory for a " << x << "×" << y << " box, try --storage=tiled or --storage=mapped"
+                  << RESET << std::endl;
+        return 1;
+    }
+}
+
+//================================================================================
+// Function: runFixedBox
+// Description:
+//     runBox for --storage=fixed: opens a SecureBoxFixed of the requested
+//     size headless (fixed_box.cpp) and reports how it went.
+//================================================================================
+int runFixedBox(uint32_t x, uint32_t y)
+{
+    std::cout << BOLD << CYAN << "SecureBox Solver" << RESET << std::endl;
+    std::cout << "Grid size: " << x << "×" << y << std::endl;
+    std::cout << "Storage: fixed (compile-time size)" << std::endl;
+    std::cout << "Mode: Headless" << std::endl;
+
+    FixedBoxRun run = openFixedBoxHeadless(x, y);
+    if (!run.solvable)
+        std::cout << RED << "No toggle sequence can unlock this box!" << RESET << std::endl;
+    else
+        std::cout << "Solved in " << run.solveMilliseconds << " ms, applied " << run.toggles << " toggles in "
+                  << run.applyMilliseconds << " ms" << std::endl;
+    std::cout << (run.opened ? GREEN + "BOX: OPENED!" : RED + "BOX: LOCKED!") << RESET << std::endl;
+    return run.opened ? 0 : 1;
+}
+
+//================================================================================
+// Function: runCalibration
+// Description:
+//     --calibrate: times every solver backend on this host and writes the
+//     fitted cost models to the profile openBox selects its solver with.
+//================================================================================
+int runCalibration(const std::string &profile)
+{
+    std::cout << BOLD << CYAN << "SecureBox Solver Calibration" << RESET << std::endl;
+    std::cout << "Memory budget: " << solver_registry_detail::formatBytes(solverMemoryBudget) << std::endl;
+    std::cout << "Threads: " << solverWorkers(solverThreads) << std::endl;
+    std::cout << std::string(50, '=') << std::endl;
+
+    if (!solverRegistry.calibrate(std::cout, solverMemoryBudget, solverThreads))
+    {
+        std::cout << RED << "A solver failed on reachable targets, no profile written" << RESET << std::endl;
+        return 1;
+    }
+
+    if (!solverRegistry.saveProfile(profile))
+    {
+        std::cout << RED << "Cannot write solver profile " << profile << RESET << std::endl;
+        return 1;
+    }
+    std::cout << GREEN << "Solver profile written to " << profile << RESET << std::endl;
+    return 0;
+}
+
+// Largest supported box in memory and on disk (2 bits per cell, 1 TiB file),
+// and largest box the step-by-step modes can display
+const uint32_t MAX_BOX_SIZE = 65536;
+const uint32_t MAX_MAPPED_BOX_SIZE = 1u << 21;
+const uint32_t MAX_INTERACTIVE_SIZE = 32;
+
+int main(int argc, char *argv[])
+{
+    bool calibrate = argc >= 2 && std::string(argv[1]) == "--calibrate";
+    if (argc < 3 && !calibrate)
+    {
+        std::cout << "Usage: " << argv[0] << " <width> <height> [--console|--headless] [--storage=flat|packed|bitsliced|tiled|mapped|fixed] [--file=<path> [--overwrite]] [--lazy] [--profile=<path>] [--memory=<MiB>] [--threads=<n>] [--cache-dir=<path>]" << std::endl;
+        std::cout << "       " << argv[0] << " --calibrate [--profile=<path>] [--memory=<MiB>] [--threads=<n>] [--cache-dir=<path>]" << std::endl;
+        std::cout << "Example: " << argv[0] << " 4 3" << std::endl;
+        std::cout << "         " << argv[0] << " 4 3 --console" << std::endl;
+        std::cout << "\nVisualization modes:" << std::endl;
+        std::cout << "  Default: Dual mode (Console + OpenGL 3D)" << std::endl;
+        std::cout << "  --console: Console only mode" << std::endl;
+        std::cout << "  --headless: Solve and apply the whole solution at once, no interaction" << std::endl;
+        std::cout << "\nStorage layouts:" << std::endl;
+        std::cout << "  flat (default): one byte per cell, contiguous rows" << std::endl;
+        std::cout << "  packed: 2 bits per cell" << std::endl;
+        std::cout << "  bitsliced: two bit planes per row" << std::endl;
+        std::cout << "  tiled: 64x64 bitsliced tiles, for boxes up to " << MAX_BOX_SIZE << "x" << MAX_BOX_SIZE << std::endl;
+        std::cout << "  mapped: 2 bits per cell in a memory-mapped file (--file=<path>, default securebox.grid)," << std::endl;
+        std::cout << "          for boxes up to " << MAX_MAPPED_BOX_SIZE << "x" << MAX_MAPPED_BOX_SIZE << std::endl;
+        std::cout << "  --overwrite: let mapped storage replace a file that is not a grid file" << std::endl;
+        std::cout << "  fixed: size fixed at compile time, whole box in a few registers," << std::endl;
+        std::cout << "         for boxes up to " << FIXED_BOX_MAX_SIZE << "x" << FIXED_BOX_MAX_SIZE << " (always headless)" << std::endl;
+        std::cout << "  --lazy: defer row/column updates until cells are read" << std::endl;
+        std::cout << "\nSolver selection (step-by-step modes):" << std::endl;
+        std::cout << "  --calibrate: time every solver on this host and write the profile" << std::endl;
+        std::cout << "  --profile=<path>: cost profile to read or write (default securebox.profile)" << std::endl;
+        std::cout << "  --memory=<MiB>: memory a solve may allocate (default "
+                  << (DEFAULT_SOLVER_MEMORY_BUDGET >> 20) << ")" << std::endl;
+        std::cout << "  --threads=<n>: threads of the multi-threaded solvers (default one per hardware thread)" << std::endl;
+        std::cout << "  --cache-dir=<path>: keep factorizations there for the next run (factorized solver)" << std::endl;
+        return 1;
+    }
+
+    uint32_t x = calibrate ? 0 : std::atol(argv[1]);
+    uint32_t y = calibrate ? 0 : std::atol(argv[2]);
+    bool forceConsole = false;
+    bool headless = false;
+    bool lazy = false;
+    bool overwrite = false;
+    std::string storage = "flat";
+    std::string file = "securebox.grid";
+    std::string profile = "securebox.profile";
+    std::string cacheDir;
+
+    for (int i = calibrate ? 2 : 3; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--console")
+            forceConsole = true;
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--lazy")
+            lazy = true;
+        else if (arg == "--overwrite")
+            overwrite = true;
+        else if (arg.rfind("--storage=", 0) == 0)
+            storage = arg.substr(10);
+        else if (arg.rfind("--file=", 0) == 0)
+            file = arg.substr(7);
+        else if (arg.rfind("--profile=", 0) == 0)
+            profile = arg.substr(10);
+        else if (arg.rfind("--cache-dir=", 0) == 0)
+            cacheDir = arg.substr(12);
+        else if (arg.rfind("--memory=", 0) == 0)
+        {
+            uint64_t mebibytes = std::strtoull(arg.c_str() + 9, nullptr, 10);
+            if (mebibytes == 0)
+            {
+                std::cout << "Invalid memory budget: " << arg << std::endl;
+                return 1;
+            }
+            solverMemoryBudget = mebibytes << 20;
+        }
+        else if (arg.rfind("--threads=", 0) == 0)
+        {
+            long threads = std::atol(arg.c_str() + 10);
+            if (threads <= 0 || threads > 1024)
+            {
+                std::cout << "Invalid thread count: " << arg << std::endl;
+                return 1;
+            }
+            solverThreads = static_cast<unsigned>(threads);
+        }
+        else
+        {
+            std::cout << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // The factorized solver writes to disk, so it only exists with a cache directory
+    if (!cacheDir.empty())
+        solverRegistry.add(solver_registry_detail::factorizedBackend(cacheDir));
+
+    if (calibrate)
+        return runCalibration(profile);
+
+    // Without a profile the built-in cost estimates stay in place
+    if (!solverRegistry.loadProfile(profile) && std::ifstream(profile))
+        std::cout << YELLOW << "Ignoring solver profile " << profile << " (unreadable or from an older version), "
+                  << "run --calibrate to rewrite it" << RESET << std::endl;
+
+    uint32_t maxSize = storage == "mapped" ? MAX_MAPPED_BOX_SIZE : MAX_BOX_SIZE;
+    if (x == 0 || y == 0 || x > maxSize || y > maxSize)
+    {
+        std::cout << "Please use dimensions between 1 and " << maxSize << "." << std::endl;
+        return 1;
+    }
+
+    if (!headless && (x > MAX_INTERACTIVE_SIZE || y > MAX_INTERACTIVE_SIZE))
+    {
+        std::cout << "Boxes larger than " << MAX_INTERACTIVE_SIZE << "×" << MAX_INTERACTIVE_SIZE
+                  << " cannot be shown step by step, running headless." << std::endl;
+        headless = true;
+    }
+
+    bool useOpenGL = !forceConsole;
+
+    if (storage == "fixed")
+    {
+        if (x > FIXED_BOX_MAX_SIZE || y > FIXED_BOX_MAX_SIZE)
+        {
+            std::cout << "Fixed storage supports boxes up to " << FIXED_BOX_MAX_SIZE << "×" << FIXED_BOX_MAX_SIZE << "." << std::endl;
+            return 1;
+        }
+        return runFixedBox(x, y);
+    }
+
+    if (storage == "flat")
+        return runBox<FlatStorage>(x, y, useOpenGL, headless, lazy);
+    if (storage == "packed")
+        return runBox<PackedStorage>(x, y, useOpenGL, headless, lazy);
+    if (storage == "bitsliced")
+        return runBox<BitslicedStorage>(x, y, useOpenGL, headless, lazy);
+    if (storage == "tiled")
+        return runBox<TiledStorage>(x, y, useOpenGL, headless, lazy);
+    if (storage == "mapped")
+    {
+        try
+        {
+            return runBox<MappedStorage>(x, y, useOpenGL, headless, lazy, MappedStorage(file, overwrite));
+        }
+        catch (const std::runtime_error &error)
+        {
+            std::cout << RED << "Mapped storage failed: " << error.what() << RESET << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Unknown storage layout: " << storage << std::endl;
+    return 1;
+}
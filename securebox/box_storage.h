@@ -0,0 +1,612 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "packed_gf3.h"
+#include "simd_kernels.h"
+
+//================================================================================
+// SecureBox storage policies
+//================================================================================
+// SecureBox keeps its grid in a storage policy. Every policy provides:
+//
+//     void    resize(uint32_t width, uint32_t height)  → all cells 0
+//     uint8_t get(uint32_t x, uint32_t y) const        → cell value 0..2
+//     void    incrementRow(uint32_t y)                 → +1 (mod 3) on row y
+//     void    incrementColumn(uint32_t x)              → +1 (mod 3) on column x
+//     void    increment(uint32_t x, uint32_t y, uint8_t amount)
+//     void    addOffsets(const uint8_t *rowOffset, const uint8_t *colOffset)
+//                                                      → +rowOffset[y] + colOffset[x] on
+//                                                        every cell, in a single pass
+//     bool    anyNonZero() const                       → O(1), from the histogram
+//     std::array<uint64_t, 3> histogram() const        → number of cells per value
+//     StateView view() const                           → read-only byte view of the grid
+//     void    lineSums(uint8_t *rowSum, uint8_t *colSum) const
+//                                                      → sum of every row and column (mod 3)
+//     void    flush()                                  → apply deferred updates
+//     static const char *name()
+//
+// FlatStorage      → one byte per cell, contiguous rows with 64-byte aligned stride
+// PackedStorage    → 2-bit trits, 32 cells per 64-bit word
+// BitslicedStorage → two bit planes per row (value 1 / value 2), 64 cells per word pair
+//
+// Row passes (and the bitsliced column pass) run through the SIMD kernels
+// selected at startup, see simd_kernels.h.
+//
+// FlatStorage hands out views of its own bytes. The packed layouts decode
+// into a byte mirror that is reused between calls and only refreshed after
+// the grid changed.
+//
+// The layouts above update cells eagerly, so their flush() does nothing.
+// LazyStorage (lazy_storage.h) wraps any of them and defers the updates.
+// TiledStorage (tiled_storage.h) splits very large grids into 64×64 tiles.
+//================================================================================
+
+//================================================================================
+// Class: AlignedAllocator
+// Description:
+//     std::allocator replacement returning memory aligned to Alignment bytes,
+//     so row starts line up with cache lines and vector registers.
+//================================================================================
+template <typename T, size_t Alignment>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T *p, size_t)
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+//================================================================================
+// Class: CellHistogram
+// Description:
+//     Running count of cells per value, kept up to date by every storage
+//     operation so that isLocked() and progress queries never scan the grid.
+//================================================================================
+class CellHistogram
+{
+private:
+    std::array<uint64_t, 3> counts{};
+
+public:
+    void reset(uint64_t cells)
+    {
+        counts = {cells, 0, 0};
+    }
+
+    //================================================================================
+    // Method: rotate
+    // Description:
+    //     cells cells were incremented by 1, before holds how many of them
+    //     were 1 and 2: zeros became ones, ones became twos, twos became zeros.
+    //================================================================================
+    void rotate(const TritCount &before, uint64_t cells)
+    {
+        uint64_t zeros = cells - before.ones - before.twos;
+        counts[0] = counts[0] - zeros + before.twos;
+        counts[1] = counts[1] - before.ones + zeros;
+        counts[2] = counts[2] - before.twos + before.ones;
+    }
+
+    void change(uint8_t from, uint8_t to)
+    {
+        --counts[from];
+        ++counts[to];
+    }
+
+    void assign(uint64_t cells, const TritCount &values)
+    {
+        counts = {cells - values.ones - values.twos, values.ones, values.twos};
+    }
+
+    uint64_t nonZero() const { return counts[1] + counts[2]; }
+    const std::array<uint64_t, 3> &values() const { return counts; }
+};
+
+//================================================================================
+// Class: StateView
+// Description:
+//     Read-only, non-owning view of a grid as rows of bytes. Valid until the
+//     box is modified. Use SecureBox::getState() for an owning snapshot.
+//================================================================================
+class StateView
+{
+private:
+    const uint8_t *base;
+    size_t rowStride;
+    uint32_t xSize, ySize;
+
+public:
+    StateView(const uint8_t *data, size_t stride, uint32_t width, uint32_t height)
+        : base(data), rowStride(stride), xSize(width), ySize(height)
+    {
+    }
+
+    const uint8_t *data() const { return base; }
+    size_t stride() const { return rowStride; }
+    uint32_t width() const { return xSize; }
+    uint32_t height() const { return ySize; }
+
+    const uint8_t *row(uint32_t y) const { return base + y * rowStride; }
+    uint8_t at(uint32_t x, uint32_t y) const { return base[y * rowStride + x]; }
+};
+
+//================================================================================
+// Class: ByteMirror
+// Description:
+//     Byte copy of a packed grid backing StateView. The buffer is allocated
+//     once and only re-decoded when the owner marked it stale.
+//================================================================================
+class ByteMirror
+{
+private:
+    mutable std::vector<uint8_t> bytes;
+    mutable bool stale = true;
+
+public:
+    void invalidate() { stale = true; }
+
+    //================================================================================
+    // Method: view
+    // Description:
+    //     decodeRow(y, out) must write the width values of row y into out.
+    //     finish(cells) runs once after a full re-decode.
+    //================================================================================
+    template <typename DecodeRow>
+    StateView view(uint32_t width, uint32_t height, DecodeRow decodeRow) const
+    {
+        return view(width, height, decodeRow, [](uint8_t *) {});
+    }
+
+    template <typename DecodeRow, typename Finish>
+    StateView view(uint32_t width, uint32_t height, DecodeRow decodeRow, Finish finish) const
+    {
+        size_t cells = static_cast<size_t>(width) * height;
+        if (bytes.size() != cells)
+        {
+            bytes.resize(cells);
+            stale = true;
+        }
+        if (stale)
+        {
+            for (uint32_t y = 0; y < height; ++y)
+                decodeRow(y, &bytes[static_cast<size_t>(y) * width]);
+            finish(bytes.data());
+            stale = false;
+        }
+        return StateView(bytes.data(), width, width, height);
+    }
+};
+
+//================================================================================
+// Class: FlatStorage
+// Description:
+//     Row-major bytes in a single allocation. The row stride is rounded up to
+//     a multiple of 64 so every row starts on its own cache line.
+//================================================================================
+class FlatStorage
+{
+private:
+    std::vector<uint8_t, AlignedAllocator<uint8_t, 64>> cells;
+    uint32_t xSize = 0, ySize = 0;
+    size_t rowStride = 0;
+    CellHistogram counts;
+
+public:
+    static const char *name() { return "flat"; }
+
+    void resize(uint32_t width, uint32_t height)
+    {
+        xSize = width;
+        ySize = height;
+        rowStride = (static_cast<size_t>(width) + 63) & ~size_t(63);
+        cells.assign(rowStride * height, 0);
+        counts.reset(static_cast<uint64_t>(width) * height);
+    }
+
+    uint8_t get(uint32_t x, uint32_t y) const
+    {
+        return cells[y * rowStride + x];
+    }
+
+    void incrementRow(uint32_t y)
+    {
+        counts.rotate(toggleKernels.incrementBytes(&cells[y * rowStride], xSize), xSize);
+    }
+
+    void incrementColumn(uint32_t x)
+    {
+        counts.rotate(toggleKernels.incrementByteColumn(&cells[x], rowStride, ySize), ySize);
+    }
+
+    void increment(uint32_t x, uint32_t y, uint8_t amount)
+    {
+        uint8_t &cell = cells[y * rowStride + x];
+        uint8_t value = (cell + amount) % 3;
+        counts.change(cell, value);
+        cell = value;
+    }
+
+    void addOffsets(const uint8_t *rowOffset, const uint8_t *colOffset)
+    {
+        TritCount after;
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            uint8_t *row = &cells[y * rowStride];
+            uint8_t r = rowOffset[y];
+            for (uint32_t x = 0; x < xSize; ++x)
+            {
+                uint8_t v = row[x] + r + colOffset[x]; // at most 6
+                v -= (v >= 3) * 3;
+                v -= (v >= 3) * 3;
+                after.ones += v == 1;
+                after.twos += v == 2;
+                row[x] = v;
+            }
+        }
+        counts.assign(static_cast<uint64_t>(xSize) * ySize, after);
+    }
+
+    bool anyNonZero() const
+    {
+        return counts.nonZero() != 0;
+    }
+
+    std::array<uint64_t, 3> histogram() const
+    {
+        return counts.values();
+    }
+
+    StateView view() const
+    {
+        return StateView(cells.data(), rowStride, xSize, ySize);
+    }
+
+    void lineSums(uint8_t *rowSum, uint8_t *colSum) const
+    {
+        std::vector<uint32_t> columns(xSize, 0);
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            const uint8_t *row = &cells[y * rowStride];
+            uint32_t sum = 0;
+            for (uint32_t x = 0; x < xSize; ++x)
+            {
+                sum += row[x];
+                columns[x] += row[x];
+            }
+            rowSum[y] = sum % 3;
+        }
+        for (uint32_t x = 0; x < xSize; ++x)
+            colSum[x] = columns[x] % 3;
+    }
+
+    void flush() {}
+};
+
+//================================================================================
+// Class: PackedStorage
+// Description:
+//     2 bits per cell, 32 cells per 64-bit word, every row padded to whole
+//     words. Padding fields are kept at 0. A row increment updates 32 cells
+//     per word with a SWAR mod-3 step:
+//         00 → 01, 01 → 10, 10 → 00
+//================================================================================
+class PackedStorage
+{
+private:
+    static constexpr uint64_t LOW_BITS = 0x5555555555555555ull;
+
+    std::vector<uint64_t> words;
+    uint32_t xSize = 0, ySize = 0;
+    size_t rowWords = 0;
+    uint64_t lastWordMask = 0; // low bits of the valid fields in the last word of a row
+    CellHistogram counts;
+    ByteMirror mirror;
+
+public:
+    static const char *name() { return "packed"; }
+
+    void resize(uint32_t width, uint32_t height)
+    {
+        mirror.invalidate();
+        xSize = width;
+        ySize = height;
+        rowWords = (static_cast<size_t>(width) + 31) / 32;
+        uint32_t tail = width % 32;
+        lastWordMask = tail ? LOW_BITS & ((uint64_t(1) << (2 * tail)) - 1) : LOW_BITS;
+        words.assign(rowWords * height, 0);
+        counts.reset(static_cast<uint64_t>(width) * height);
+    }
+
+    uint8_t get(uint32_t x, uint32_t y) const
+    {
+        return (words[y * rowWords + x / 32] >> (2 * (x % 32))) & 3;
+    }
+
+    void incrementRow(uint32_t y)
+    {
+        mirror.invalidate();
+        counts.rotate(toggleKernels.incrementTrits(&words[y * rowWords], rowWords, lastWordMask), xSize);
+    }
+
+    void incrementColumn(uint32_t x)
+    {
+        mirror.invalidate();
+        uint64_t field = uint64_t(1) << (2 * (x % 32));
+        counts.rotate(toggleKernels.incrementTritColumn(&words[x / 32], rowWords, ySize, field), ySize);
+    }
+
+    void increment(uint32_t x, uint32_t y, uint8_t amount)
+    {
+        mirror.invalidate();
+        uint64_t &w = words[y * rowWords + x / 32];
+        unsigned shift = 2 * (x % 32);
+        uint64_t value = (w >> shift) & 3;
+        uint64_t next = (value + amount) % 3;
+        counts.change(static_cast<uint8_t>(value), static_cast<uint8_t>(next));
+        w ^= (value ^ next) << shift;
+    }
+
+    void addOffsets(const uint8_t *rowOffset, const uint8_t *colOffset)
+    {
+        mirror.invalidate();
+        // Column offsets packed once as (value 1, value 2) bit pairs, for every
+        // possible row offset, then added word by word in bitsliced form
+        std::vector<uint64_t> colOnes[3], colTwos[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            colOnes[r].assign(rowWords, 0);
+            colTwos[r].assign(rowWords, 0);
+            for (uint32_t x = 0; x < xSize; ++x)
+            {
+                int v = (colOffset[x] + r) % 3;
+                uint64_t bit = uint64_t(1) << (2 * (x % 32));
+                if (v == 1)
+                    colOnes[r][x / 32] |= bit;
+                else if (v == 2)
+                    colTwos[r][x / 32] |= bit;
+            }
+        }
+
+        TritCount after;
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            uint64_t *row = &words[y * rowWords];
+            const std::vector<uint64_t> &ones = colOnes[rowOffset[y] % 3];
+            const std::vector<uint64_t> &twos = colTwos[rowOffset[y] % 3];
+            for (size_t w = 0; w < rowWords; ++w)
+            {
+                uint64_t lo = row[w] & LOW_BITS, hi = (row[w] >> 1) & LOW_BITS;
+                gf3::add(lo, hi, ones[w], twos[w], lo, hi);
+                after.ones += gf3::popCount(lo);
+                after.twos += gf3::popCount(hi);
+                row[w] = lo | (hi << 1);
+            }
+        }
+        counts.assign(static_cast<uint64_t>(xSize) * ySize, after);
+    }
+
+    bool anyNonZero() const
+    {
+        return counts.nonZero() != 0;
+    }
+
+    std::array<uint64_t, 3> histogram() const
+    {
+        return counts.values();
+    }
+
+    StateView view() const
+    {
+        return mirror.view(xSize, ySize, [this](uint32_t y, uint8_t *out) {
+            const uint64_t *row = &words[y * rowWords];
+            for (uint32_t x = 0; x < xSize; ++x)
+                out[x] = (row[x / 32] >> (2 * (x % 32))) & 3;
+        });
+    }
+
+    void lineSums(uint8_t *rowSum, uint8_t *colSum) const
+    {
+        std::vector<uint32_t> columns(xSize, 0);
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            const uint64_t *row = &words[y * rowWords];
+            uint32_t sum = 0;
+            for (size_t w = 0; w < rowWords; ++w)
+                sum += gf3::popCount(row[w] & LOW_BITS) + 2 * gf3::popCount((row[w] >> 1) & LOW_BITS);
+            rowSum[y] = sum % 3;
+            for (uint32_t x = 0; x < xSize; ++x)
+                columns[x] += (row[x / 32] >> (2 * (x % 32))) & 3;
+        }
+        for (uint32_t x = 0; x < xSize; ++x)
+            colSum[x] = columns[x] % 3;
+    }
+
+    void flush() {}
+};
+
+//================================================================================
+// Class: BitslicedStorage
+// Description:
+//     Every row is two planes of 64-bit words: ones (value 1) and twos
+//     (value 2). A row increment is two bitwise ops per 64 cells:
+//         ones' = ~(ones | twos), twos' = ones
+//================================================================================
+class BitslicedStorage
+{
+private:
+    std::vector<uint64_t> words; // per row: ones plane, then twos plane
+    uint32_t xSize = 0, ySize = 0;
+    size_t planeWords = 0;
+    uint64_t lastWordMask = 0;
+    CellHistogram counts;
+    ByteMirror mirror;
+
+    uint64_t *ones(uint32_t y) { return &words[y * 2 * planeWords]; }
+    uint64_t *twos(uint32_t y) { return &words[y * 2 * planeWords + planeWords]; }
+    const uint64_t *ones(uint32_t y) const { return &words[y * 2 * planeWords]; }
+    const uint64_t *twos(uint32_t y) const { return &words[y * 2 * planeWords + planeWords]; }
+
+    void incrementBit(uint32_t y, size_t word, uint64_t bit)
+    {
+        uint64_t &one = ones(y)[word];
+        uint64_t &two = twos(y)[word];
+        uint64_t wasOne = one & bit;
+        uint64_t wasZero = ~(one | two) & bit;
+        one = (one & ~bit) | wasZero;
+        two = (two & ~bit) | wasOne;
+    }
+
+public:
+    static const char *name() { return "bitsliced"; }
+
+    void resize(uint32_t width, uint32_t height)
+    {
+        mirror.invalidate();
+        xSize = width;
+        ySize = height;
+        planeWords = (static_cast<size_t>(width) + 63) / 64;
+        uint32_t tail = width % 64;
+        lastWordMask = tail ? (uint64_t(1) << tail) - 1 : ~uint64_t(0);
+        words.assign(2 * planeWords * height, 0);
+        counts.reset(static_cast<uint64_t>(width) * height);
+    }
+
+    uint8_t get(uint32_t x, uint32_t y) const
+    {
+        uint64_t bit = uint64_t(1) << (x % 64);
+        if (ones(y)[x / 64] & bit)
+            return 1;
+        return (twos(y)[x / 64] & bit) ? 2 : 0;
+    }
+
+    void incrementRow(uint32_t y)
+    {
+        mirror.invalidate();
+        counts.rotate(toggleKernels.incrementPlanes(ones(y), twos(y), planeWords, lastWordMask), xSize);
+    }
+
+    void incrementColumn(uint32_t x)
+    {
+        mirror.invalidate();
+        size_t word = x / 64;
+        counts.rotate(toggleKernels.incrementBitColumn(ones(0) + word, twos(0) + word, 2 * planeWords,
+                                                       ySize, uint64_t(1) << (x % 64)),
+                      ySize);
+    }
+
+    void increment(uint32_t x, uint32_t y, uint8_t amount)
+    {
+        mirror.invalidate();
+        uint8_t value = get(x, y);
+        for (uint8_t i = 0; i < amount % 3; ++i)
+            incrementBit(y, x / 64, uint64_t(1) << (x % 64));
+        counts.change(value, (value + amount) % 3);
+    }
+
+    void addOffsets(const uint8_t *rowOffset, const uint8_t *colOffset)
+    {
+        mirror.invalidate();
+        // Column offsets as planes for every possible row offset
+        std::vector<uint64_t> colOnes[3], colTwos[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            colOnes[r].assign(planeWords, 0);
+            colTwos[r].assign(planeWords, 0);
+            for (uint32_t x = 0; x < xSize; ++x)
+            {
+                int v = (colOffset[x] + r) % 3;
+                uint64_t bit = uint64_t(1) << (x % 64);
+                if (v == 1)
+                    colOnes[r][x / 64] |= bit;
+                else if (v == 2)
+                    colTwos[r][x / 64] |= bit;
+            }
+        }
+
+        TritCount after;
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            uint64_t *p1 = ones(y), *p2 = twos(y);
+            const std::vector<uint64_t> &o = colOnes[rowOffset[y] % 3];
+            const std::vector<uint64_t> &t = colTwos[rowOffset[y] % 3];
+            for (size_t w = 0; w < planeWords; ++w)
+            {
+                gf3::add(p1[w], p2[w], o[w], t[w], p1[w], p2[w]);
+                after.ones += gf3::popCount(p1[w]);
+                after.twos += gf3::popCount(p2[w]);
+            }
+        }
+        counts.assign(static_cast<uint64_t>(xSize) * ySize, after);
+    }
+
+    bool anyNonZero() const
+    {
+        return counts.nonZero() != 0;
+    }
+
+    std::array<uint64_t, 3> histogram() const
+    {
+        return counts.values();
+    }
+
+    StateView view() const
+    {
+        return mirror.view(xSize, ySize, [this](uint32_t y, uint8_t *out) {
+            const uint64_t *p1 = ones(y), *p2 = twos(y);
+            for (uint32_t x = 0; x < xSize; ++x)
+                out[x] = ((p1[x / 64] >> (x % 64)) & 1) | (((p2[x / 64] >> (x % 64)) & 1) << 1);
+        });
+    }
+
+    void lineSums(uint8_t *rowSum, uint8_t *colSum) const
+    {
+        std::vector<uint32_t> columns(xSize, 0);
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            const uint64_t *p1 = ones(y), *p2 = twos(y);
+            uint32_t sum = 0;
+            for (size_t w = 0; w < planeWords; ++w)
+            {
+                sum += gf3::popCount(p1[w]) + 2 * gf3::popCount(p2[w]);
+                for (uint64_t bits = p1[w]; bits; bits &= bits - 1)
+                    columns[w * 64 + gf3::countTrailingZeros(bits)] += 1;
+                for (uint64_t bits = p2[w]; bits; bits &= bits - 1)
+                    columns[w * 64 + gf3::countTrailingZeros(bits)] += 2;
+            }
+            rowSum[y] = sum % 3;
+        }
+        for (uint32_t x = 0; x < xSize; ++x)
+            colSum[x] = columns[x] % 3;
+    }
+
+    void flush() {}
+};
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "solve_result.h"
+
+//================================================================================
+// Closed-form solver
+//================================================================================
+// The toggle operator only depends on row and column sums. For a toggle vector
+// t with row sums R[y] and column sums C[x] it produces:
+//
+//     (A t)[y][x] = R[y] + C[x] - t[y][x]                          (mod 3)
+//
+// so every solution of A t = b has the form t[y][x] = R[y] + C[x] - b[y][x].
+// Summing that identity over a row / column gives (with S = ΣR = ΣC):
+//
+//     (W - 1) * R[y] + S = Brow[y]        (H - 1) * C[x] + S = Bcol[x]
+//
+// which is a system of W + H unknowns instead of (W·H)². The mod-3 classes of
+// W and H decide how it degenerates:
+//
+//     W ≢ 1, H ≢ 1, W + H ≢ 1   unique solution
+//     W ≡ 2, H ≡ 2              solvable iff ΣB = 0, nullity 1 (all-ones grid)
+//     W ≡ 1, H ≢ 1              solvable iff all row sums of B are equal, nullity H - 1
+//     W ≢ 1, H ≡ 1              solvable iff all column sums of B are equal, nullity W - 1
+//     W ≡ 1, H ≡ 1              solvable iff all row and column sums of B are equal,
+//                               nullity W + H - 2
+//================================================================================
+
+namespace closed_form_detail
+{
+    constexpr int mod3(int v)
+    {
+        v %= 3;
+        return v < 0 ? v + 3 : v;
+    }
+
+    // 1 and 2 are their own inverses in GF(3)
+    constexpr int inverse3(int v)
+    {
+        return v;
+    }
+
+    //================================================================================
+    // Function: solveLineTotals
+    // Description:
+    //     The line equations for W ≡ WMOD and H ≡ HMOD (mod 3): R[0..H) and
+    //     C[0..W) from the row and column sums of the target (mod 3), or
+    //     false when the target is not in the range. Only the mod-3 classes
+    //     pick the case, so they are template arguments and the branches
+    //     resolve at compile time; lineTotalsFor picks the instantiation at
+    //     run time.
+    //================================================================================
+    template <uint32_t WMOD, uint32_t HMOD>
+    bool solveLineTotals(const int *rowSum, const int *colSum, uint32_t width, uint32_t height, int *R, int *C)
+    {
+        int total = 0;
+        for (uint32_t y = 0; y < height; ++y)
+            total += rowSum[y];
+        total = mod3(total);
+
+        constexpr int a = mod3(static_cast<int>(WMOD) - 1); // W - 1
+        constexpr int b = mod3(static_cast<int>(HMOD) - 1); // H - 1
+        constexpr int w = static_cast<int>(WMOD);
+        constexpr int h = static_cast<int>(HMOD);
+
+        for (uint32_t y = 0; y < height; ++y)
+            R[y] = 0;
+        for (uint32_t x = 0; x < width; ++x)
+            C[x] = 0;
+
+        if constexpr (a != 0 && b != 0)
+        {
+            // a * S + h * S = total and w * S + b * S = total, with S = ΣR = ΣC
+            int sumR = 0, sumC = 0;
+            constexpr int det = mod3(a * b - h * w);
+            if constexpr (det != 0)
+            {
+                sumR = mod3((total * b - h * total) * inverse3(det));
+                sumC = mod3((a * total - w * total) * inverse3(det));
+            }
+            else
+            {
+                // W ≡ H ≡ 2: both equations collapse to 2S = total
+                if (total != 0)
+                    return false;
+            }
+
+            for (uint32_t y = 0; y < height; ++y)
+                R[y] = mod3((rowSum[y] - sumC) * inverse3(a));
+            for (uint32_t x = 0; x < width; ++x)
+                C[x] = mod3((colSum[x] - sumR) * inverse3(b));
+        }
+        else if constexpr (a == 0 && b != 0)
+        {
+            // W ≡ 1: every row sum of the target must equal ΣC
+            for (uint32_t y = 1; y < height; ++y)
+                if (rowSum[y] != rowSum[0])
+                    return false;
+
+            int sumR = mod3(total - b * rowSum[0]);
+            R[0] = sumR;
+            for (uint32_t x = 0; x < width; ++x)
+                C[x] = mod3((colSum[x] - sumR) * inverse3(b));
+        }
+        else if constexpr (a != 0 && b == 0)
+        {
+            // H ≡ 1: every column sum of the target must equal ΣR
+            for (uint32_t x = 1; x < width; ++x)
+                if (colSum[x] != colSum[0])
+                    return false;
+
+            int sumC = mod3(total - a * colSum[0]);
+            C[0] = sumC;
+            for (uint32_t y = 0; y < height; ++y)
+                R[y] = mod3((rowSum[y] - sumC) * inverse3(a));
+        }
+        else
+        {
+            // W ≡ H ≡ 1: all row sums equal ΣC, all column sums equal ΣR, and ΣR = ΣC
+            for (uint32_t y = 1; y < height; ++y)
+                if (rowSum[y] != rowSum[0])
+                    return false;
+            for (uint32_t x = 1; x < width; ++x)
+                if (colSum[x] != colSum[0])
+                    return false;
+            if (rowSum[0] != colSum[0])
+                return false;
+
+            R[0] = colSum[0];
+            C[0] = rowSum[0];
+        }
+        return true;
+    }
+
+    using LineTotalsSolver = bool (*)(const int *, const int *, uint32_t, uint32_t, int *, int *);
+
+    // The solveLineTotals instantiation for the mod-3 classes of the size
+    inline LineTotalsSolver lineTotalsFor(uint32_t width, uint32_t height)
+    {
+        static constexpr LineTotalsSolver byClass[9] = {
+            &solveLineTotals<0, 0>, &solveLineTotals<0, 1>, &solveLineTotals<0, 2>,
+            &solveLineTotals<1, 0>, &solveLineTotals<1, 1>, &solveLineTotals<1, 2>,
+            &solveLineTotals<2, 0>, &solveLineTotals<2, 1>, &solveLineTotals<2, 2>,
+        };
+        return byClass[(width % 3) * 3 + height % 3];
+    }
+}
+
+//================================================================================
+// Function: closedFormNullity
+// Description:
+//     Returns the nullity of the W·H toggle operator, i.e. the box has
+//     3^nullity toggle vectors for every solvable state.
+//================================================================================
+constexpr uint32_t closedFormNullity(uint32_t width, uint32_t height)
+{
+    bool rowsDegenerate = width % 3 == 1;
+    bool colsDegenerate = height % 3 == 1;
+
+    if (rowsDegenerate && colsDegenerate)
+        return width + height - 2;
+    if (rowsDegenerate)
+        return height - 1;
+    if (colsDegenerate)
+        return width - 1;
+    return (width + height - 1) % 3 == 0 ? 1 : 0;
+}
+
+//================================================================================
+// Function: closedFormNullspace
+// Description:
+//     Kernel basis of the toggle operator in the SolveResult::nullspace
+//     layout. A kernel vector is t[y][x] = r[y] + c[x] with
+//     (1 - W) r[y] + (1 - H) c[x] = Σr + Σc for all x, y, which gives:
+//         W ≡ 1: rows r = e_y - e_0 for y ≥ 1 (a row of 1s minus row 0)
+//         H ≡ 1: columns c = e_x - e_0 for x ≥ 1
+//         W ≡ 2, H ≡ 2: the all-ones grid
+//     closedFormNullity(W, H) vectors of W·H cells each, so only meant for
+//     boxes small enough to search their solutions (min_toggle_search.h).
+//================================================================================
+inline std::shared_ptr<const PackedGF3Matrix> closedFormNullspace(uint32_t width, uint32_t height)
+{
+    size_t cells = static_cast<size_t>(width) * height;
+    auto basis = std::make_shared<PackedGF3Matrix>(closedFormNullity(width, height), cells);
+    size_t k = 0;
+
+    if (width % 3 == 1)
+        for (uint32_t y = 1; y < height; ++y, ++k)
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                basis->set(k, static_cast<size_t>(y) * width + x, 1);
+                basis->set(k, x, 2);
+            }
+
+    if (height % 3 == 1)
+        for (uint32_t x = 1; x < width; ++x, ++k)
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                basis->set(k, static_cast<size_t>(y) * width + x, 1);
+                basis->set(k, static_cast<size_t>(y) * width, 2);
+            }
+
+    if (k == 0 && basis->rows() == 1)
+        for (size_t cell = 0; cell < cells; ++cell)
+            basis->set(0, cell, 1);
+
+    return basis;
+}
+
+//================================================================================
+// Struct: LineSolution
+// Description:
+//     Row and column sums (mod 3) of a solution toggle vector, only meaningful
+//     when solvable is set. Together with the target they describe the whole
+//     solution:
+//         t[y][x] = rowTotal[y] + colTotal[x] - target[y][x]
+//================================================================================
+struct LineSolution
+{
+    bool solvable = false;
+    uint32_t nullity = 0;
+    std::vector<int> rowTotal, colTotal;
+};
+
+//================================================================================
+// Function: solveClosedFormLines
+// Description:
+//     Solves the W + H line equations from the row and column sums (mod 3) of
+//     the target alone. O(W + H) time and memory, so the full target never
+//     has to exist as a vector, which is what makes very large boxes possible.
+//================================================================================
+inline LineSolution solveClosedFormLines(uint32_t width, uint32_t height,
+                                         const std::vector<int> &rowSum, const std::vector<int> &colSum)
+{
+    LineSolution result;
+    result.nullity = closedFormNullity(width, height);
+
+    // R[y] and C[x] of the solution (its actual row and column sums)
+    result.rowTotal.assign(height, 0);
+    result.colTotal.assign(width, 0);
+    result.solvable = closed_form_detail::lineTotalsFor(width, height)(
+        rowSum.data(), colSum.data(), width, height, result.rowTotal.data(), result.colTotal.data());
+    return result;
+}
+
+//================================================================================
+// Function: solveClosedForm
+// Description:
+//     Solves A t = target for the toggle operator in O(W·H) time and memory.
+//     target is row-major (y * width + x) with values in 0..2. Free parameters
+//     of a singular system are set to 0.
+//================================================================================
+inline SolveResult solveClosedForm(uint32_t width, uint32_t height, const std::vector<int> &target)
+{
+    using closed_form_detail::mod3;
+
+    std::vector<int> rowSum(height, 0), colSum(width, 0);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const int *row = &target[static_cast<size_t>(y) * width];
+        int sum = 0;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            sum += row[x];
+            colSum[x] += row[x];
+        }
+        rowSum[y] = mod3(sum);
+    }
+    for (auto &sum : colSum)
+        sum = mod3(sum);
+
+    LineSolution lines = solveClosedFormLines(width, height, rowSum, colSum);
+
+    SolveResult result;
+    result.nullity = lines.nullity;
+    result.rank = static_cast<uint32_t>(static_cast<size_t>(width) * height - lines.nullity);
+    if (!lines.solvable)
+        return result;
+
+    result.solution.resize(static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const int *row = &target[static_cast<size_t>(y) * width];
+        int *out = &result.solution[static_cast<size_t>(y) * width];
+        for (uint32_t x = 0; x < width; ++x)
+            out[x] = mod3(lines.rowTotal[y] + lines.colTotal[x] - row[x]);
+    }
+
+    result.solvable = true;
+    return result;
+}
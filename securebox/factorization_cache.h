@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "factorization_store.h"
+#include "gf3_factorization.h"
+#include "packed_solver.h"
+#include "solve_result.h"
+
+//================================================================================
+// Class: FactorizationCache
+// Description:
+//     One GF3Factorization per grid size, built on first use from
+//     build(width, height) (the SecureBox effect matrix by default) and shared
+//     afterwards. Safe to use from several threads: different sizes are
+//     factored concurrently, callers asking for a size that is still being
+//     factored wait for it instead of repeating the work.
+//
+//     With a FactorizationStore, sizes missing in memory are loaded from disk
+//     first, and freshly built factorizations are saved there for the next
+//     process.
+//================================================================================
+class FactorizationCache
+{
+public:
+    using Builder = std::function<PackedGF3Matrix(uint32_t, uint32_t)>;
+
+private:
+    struct Entry
+    {
+        std::once_flag built;
+        std::shared_ptr<const GF3Factorization> factorization;
+    };
+
+    Builder build;
+    std::shared_ptr<const FactorizationStore> store;
+    std::mutex lock;
+    std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<Entry>> entries;
+
+public:
+    explicit FactorizationCache(Builder builder = buildPackedEffectMatrix,
+                                std::shared_ptr<const FactorizationStore> diskStore = nullptr)
+        : build(std::move(builder)), store(std::move(diskStore))
+    {
+    }
+
+    std::shared_ptr<const GF3Factorization> get(uint32_t width, uint32_t height)
+    {
+        std::shared_ptr<Entry> entry;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto &slot = entries[{width, height}];
+            if (!slot)
+                slot = std::make_shared<Entry>();
+            entry = slot;
+        }
+
+        std::call_once(entry->built, [&] {
+            if (store)
+                entry->factorization = store->load(width, height);
+            if (entry->factorization)
+                return;
+            entry->factorization = std::make_shared<const GF3Factorization>(build(width, height));
+            if (store)
+                store->save(width, height, *entry->factorization);
+        });
+        return entry->factorization;
+    }
+
+    SolveResult solve(uint32_t width, uint32_t height, const std::vector<int> &target)
+    {
+        return get(width, height)->solve(target);
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return entries.size();
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        entries.clear();
+    }
+};
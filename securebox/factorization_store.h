@@ -0,0 +1,347 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "gf3_factorization.h"
+#include "mapped_storage.h"
+
+//================================================================================
+// Factorization file layout (little endian)
+//================================================================================
+//
+//     offset  size  field
+//     0       8     magic        "SBFACTOR"
+//     8       4     version      2
+//     12      4     headerSize   64
+//     16      4     width
+//     20      4     height
+//     24      8     rows         equations, rows of the transform, width·height
+//     32      8     cols         unknowns, width·height
+//     40      8     rank         pivot rows
+//     48      8     checksum     of the whole file, with this field read as 0
+//     56      8     reserved     0
+//     64      ...   pivots       rank × uint32 pivot columns, zero padded
+//     4096·k  ...   transform    rows × 2·wordsFor(rows) words, every row its
+//                                ones plane followed by its twos plane
+//
+// The transform starts at the first page boundary after the pivots, so it is
+// used straight from the mapping. The file is a whole number of words,
+// which the checksum runs over.
+//================================================================================
+
+namespace factorization_detail
+{
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t width;
+        uint32_t height;
+        uint64_t rows;
+        uint64_t cols;
+        uint64_t rank;
+        uint64_t checksum;
+        uint64_t reserved;
+    };
+    static_assert(sizeof(Header) == 64, "factorization header layout changed");
+
+    constexpr char MAGIC[8] = {'S', 'B', 'F', 'A', 'C', 'T', 'O', 'R'};
+    constexpr uint32_t VERSION = 2;
+    constexpr size_t PAGE = 4096;
+    constexpr const char *EXTENSION = ".sbf";
+
+    inline size_t transformOffset(size_t rank)
+    {
+        return (sizeof(Header) + rank * sizeof(uint32_t) + PAGE - 1) / PAGE * PAGE;
+    }
+
+    //================================================================================
+    // Class: Checksum
+    // Description:
+    //     64-bit hash of a word stream, four independent multiply-rotate lanes
+    //     so it keeps up with memory. Detects torn or corrupted files, it is
+    //     not meant to resist deliberate tampering.
+    //================================================================================
+    class Checksum
+    {
+    private:
+        static constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+        uint64_t lane[4] = {1, 2, 3, 4};
+        uint64_t count = 0;
+
+    public:
+        void update(const uint64_t *words, size_t size)
+        {
+            for (size_t i = 0; i < size; ++i, ++count)
+            {
+                uint64_t v = (lane[count & 3] ^ words[i]) * PRIME;
+                lane[count & 3] = (v << 29) | (v >> 35);
+            }
+        }
+
+        uint64_t value() const
+        {
+            uint64_t hash = count;
+            for (uint64_t l : lane)
+                hash = (hash ^ l) * PRIME;
+            return hash ^ (hash >> 32);
+        }
+    };
+
+    // Starts the checksum of a file with its header, checksum field as 0
+    inline Checksum headerChecksum(Header header)
+    {
+        header.checksum = 0;
+        uint64_t words[sizeof(Header) / sizeof(uint64_t)];
+        std::memcpy(words, &header, sizeof(Header));
+        Checksum sum;
+        sum.update(words, sizeof(Header) / sizeof(uint64_t));
+        return sum;
+    }
+}
+
+//================================================================================
+// Class: FactorizationStore
+// Description:
+//     Directory of GF3Factorization files, one per (tag, width, height). The
+//     tag names the toggle rule, since the factorization depends on it.
+//         - load() maps the file read-only and solves straight from the
+//           mapping, so a fresh process pays for page-ins instead of an
+//           elimination. Files with a bad header or checksum are deleted
+//           and reported as missing.
+//         - save() writes to a uniquely named temporary file in the same
+//           directory and renames it over the final name, so concurrent
+//           processes only ever see complete files. The last writer wins,
+//           which is fine since every writer produces the same content.
+//         - Files are evicted least recently used first once the directory
+//           holds more than budgetBytes. load() refreshes the modification
+//           time, which serves as the last-use time. Temporaries carry the
+//           extension too, so ones left behind by a crashed writer count
+//           against the budget and are swept like any old file.
+//     Failures are not fatal for a cache: load() returns nullptr and save()
+//     false, the caller just factors again.
+//================================================================================
+class FactorizationStore
+{
+private:
+    std::filesystem::path directory;
+    uint64_t budget;
+    std::string tag;
+
+    std::filesystem::path pathFor(uint32_t width, uint32_t height) const
+    {
+        return directory / (tag + "-" + std::to_string(width) + "x" + std::to_string(height) +
+                            factorization_detail::EXTENSION);
+    }
+
+public:
+    FactorizationStore(std::filesystem::path cacheDirectory, uint64_t budgetBytes = uint64_t(4) << 30,
+                       std::string rule = "rowcolumn")
+        : directory(std::move(cacheDirectory)), budget(budgetBytes), tag(std::move(rule))
+    {
+    }
+
+    const std::filesystem::path &path() const { return directory; }
+
+    //================================================================================
+    // Method: load
+    // Description:
+    //     The stored factorization for the size, or nullptr when there is
+    //     none or it is unusable. verify = false skips the checksum pass over
+    //     the file, leaving pages to be read on first use.
+    //================================================================================
+    std::shared_ptr<const GF3Factorization> load(uint32_t width, uint32_t height, bool verify = true) const
+    {
+        using namespace factorization_detail;
+
+        std::filesystem::path file = pathFor(width, height);
+        std::error_code error;
+        if (!std::filesystem::exists(file, error))
+            return nullptr;
+
+        auto mapped = std::make_shared<mapped_detail::FileMapping>();
+        try
+        {
+            mapped->openReadOnly(file.string());
+        }
+        catch (const std::runtime_error &)
+        {
+            return nullptr;
+        }
+
+        const uint8_t *base = mapped->data();
+        size_t length = mapped->size();
+
+        Header header = {};
+        bool valid = length >= sizeof(Header);
+        if (valid)
+        {
+            std::memcpy(&header, base, sizeof(Header));
+            size_t words = gf3::wordsFor(header.rows);
+            valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.version == VERSION &&
+                    header.headerSize == sizeof(Header) && header.width == width && header.height == height &&
+                    header.rows == uint64_t(width) * height && header.cols == header.rows &&
+                    header.rank <= header.rows &&
+                    length == transformOffset(header.rank) + header.rows * 2 * words * sizeof(uint64_t);
+        }
+        if (valid && verify)
+        {
+            Checksum sum = headerChecksum(header);
+            sum.update(reinterpret_cast<const uint64_t *>(base + sizeof(Header)),
+                       (length - sizeof(Header)) / sizeof(uint64_t));
+            valid = sum.value() == header.checksum;
+        }
+
+        // Pivots index the solution, so they are range checked even unverified
+        std::vector<size_t> pivots;
+        if (valid)
+        {
+            pivots.resize(header.rank);
+            const uint8_t *pivotBytes = base + sizeof(Header);
+            for (size_t i = 0; i < pivots.size() && valid; ++i)
+            {
+                uint32_t column;
+                std::memcpy(&column, pivotBytes + i * sizeof(uint32_t), sizeof(column));
+                pivots[i] = column;
+                valid = column < header.cols;
+            }
+        }
+
+        if (!valid)
+        {
+            mapped.reset();
+            std::filesystem::remove(file, error);
+            return nullptr;
+        }
+
+        std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), error);
+
+        const uint64_t *transform = reinterpret_cast<const uint64_t *>(base + transformOffset(header.rank));
+        return std::make_shared<const GF3Factorization>(GF3Factorization::fromMemory(
+            header.rows, header.cols, std::move(pivots), transform, std::move(mapped)));
+    }
+
+    //================================================================================
+    // Method: save
+    // Description:
+    //     Writes the factorization atomically and evicts old files if the
+    //     directory went over budget. Returns false when it could not be
+    //     written.
+    //================================================================================
+    bool save(uint32_t width, uint32_t height, const GF3Factorization &factorization) const
+    {
+        using namespace factorization_detail;
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        size_t offset = transformOffset(factorization.rank());
+        std::vector<uint64_t> prefix((offset - sizeof(Header)) / sizeof(uint64_t), 0);
+        for (size_t i = 0; i < factorization.rank(); ++i)
+        {
+            uint32_t column = static_cast<uint32_t>(factorization.pivotColumns()[i]);
+            std::memcpy(reinterpret_cast<uint8_t *>(prefix.data()) + i * sizeof(uint32_t), &column, sizeof(column));
+        }
+
+        Header header = {};
+        std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.headerSize = sizeof(Header);
+        header.width = width;
+        header.height = height;
+        header.rows = factorization.rows();
+        header.cols = factorization.cols();
+        header.rank = factorization.rank();
+
+        Checksum sum = headerChecksum(header);
+        sum.update(prefix.data(), prefix.size());
+        sum.update(factorization.transformWords(), factorization.transformWordCount());
+        header.checksum = sum.value();
+
+        std::filesystem::path file = pathFor(width, height);
+        std::filesystem::path temporary = file;
+        temporary.replace_extension("." + std::to_string(std::random_device()()) + ".tmp" + EXTENSION);
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(prefix.data()),
+                      static_cast<std::streamsize>(prefix.size() * sizeof(uint64_t)));
+            out.write(reinterpret_cast<const char *>(factorization.transformWords()),
+                      static_cast<std::streamsize>(factorization.transformWordCount() * sizeof(uint64_t)));
+            if (!out.flush())
+            {
+                out.close();
+                std::filesystem::remove(temporary, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temporary, file, error);
+        if (error)
+        {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+
+        evict(file);
+        return true;
+    }
+
+    //================================================================================
+    // Method: evict
+    // Description:
+    //     Deletes the least recently used factorization files until the
+    //     directory fits the budget. keep is never deleted. Files that
+    //     vanish or cannot be deleted meanwhile (another process, or a file
+    //     still mapped on Windows) are skipped.
+    //================================================================================
+    void evict(const std::filesystem::path &keep = {}) const
+    {
+        struct Entry
+        {
+            std::filesystem::file_time_type used;
+            uint64_t size;
+            std::filesystem::path path;
+        };
+
+        std::error_code error;
+        std::vector<Entry> files;
+        uint64_t total = 0;
+        for (const auto &item : std::filesystem::directory_iterator(directory, error))
+        {
+            if (item.path().extension() != factorization_detail::EXTENSION)
+                continue;
+            std::error_code itemError;
+            uint64_t size = item.file_size(itemError);
+            auto used = item.last_write_time(itemError);
+            if (itemError)
+                continue;
+            files.push_back({used, size, item.path()});
+            total += size;
+        }
+
+        std::sort(files.begin(), files.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+        for (const Entry &entry : files)
+        {
+            if (total <= budget)
+                break;
+            if (entry.path == keep)
+                continue;
+            if (std::filesystem::remove(entry.path, error))
+                total -= entry.size;
+        }
+    }
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "closed_form_solver.h"
+#include "secure_box_fixed.h"
+#include "solve_result.h"
+
+//================================================================================
+// Closed form for small boxes
+//================================================================================
+// For every W, H ≤ FIXED_BOX_MAX_SIZE the solve is the closed form with all
+// its work arrays on the stack. Nothing is inverted or eliminated; the math
+// is solveClosedForm's.
+//
+// Every solution is t = R[y] + C[x] - b, and (R, C) come from the W + H line
+// sums of b through the solveLineTotals instantiation of the size's mod-3
+// class (closed_form_detail::lineTotalsFor), so all sizes share 9 solver
+// bodies. The line sums come from a single pass over b into arrays on the
+// stack, and a second, division-free pass writes t. The pointer overload of
+// solveFixedClosedForm uses no heap; the SolveResult one only allocates the
+// solution vector.
+//
+// The nullspace of a size is closedFormNullspace, built once and shared, so
+// only the first solve of a size allocates it. Nothing here is instantiated
+// per size, the whole file compiles to the 9 mod-class bodies.
+//================================================================================
+
+namespace fixed_closed_form_detail
+{
+    //================================================================================
+    // Function: solveLines
+    // Description:
+    //     The line sums in one pass over b into arrays on the stack, the line
+    //     equations of the size's mod-3 class, then t = R[y] + C[x] - b in a
+    //     second pass.
+    //================================================================================
+    inline bool solveLines(const int *b, int *t, uint32_t width, uint32_t height)
+    {
+        // Column sums accumulate in their own array so the inner loop is a
+        // plain vector add
+        int rows[FIXED_BOX_MAX_SIZE] = {}, columns[FIXED_BOX_MAX_SIZE] = {};
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const int *row = b + y * width;
+            int sum = 0;
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                sum += row[x];
+                columns[x] += row[x];
+            }
+            rows[y] = sum % 3;
+        }
+        for (uint32_t x = 0; x < width; ++x)
+            columns[x] %= 3;
+
+        int rowTotals[FIXED_BOX_MAX_SIZE], columnTotals[FIXED_BOX_MAX_SIZE];
+        if (!closed_form_detail::lineTotalsFor(width, height)(rows, columns, width, height, rowTotals, columnTotals))
+            return false;
+
+        // v = R[y] + C[x] + 2 b is 0..8, where v - 3 · ((v · 11) >> 5) is v mod 3
+        // without a division, so the pass vectorizes
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const int *row = b + y * width;
+            int *out = t + y * width;
+            int rowTotal = rowTotals[y];
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                int v = rowTotal + columnTotals[x] + 2 * row[x];
+                out[x] = v - 3 * ((v * 11) >> 5);
+            }
+        }
+        return true;
+    }
+
+    //================================================================================
+    // Function: nullspace
+    // Description:
+    //     closedFormNullspace(width, height), built on first use per size and
+    //     shared by every later solve of that size.
+    //================================================================================
+    inline std::shared_ptr<const PackedGF3Matrix> nullspace(uint32_t width, uint32_t height)
+    {
+        constexpr size_t SIZES = FIXED_BOX_MAX_SIZE * FIXED_BOX_MAX_SIZE;
+        static std::once_flag built[SIZES];
+        static std::shared_ptr<const PackedGF3Matrix> basis[SIZES];
+
+        size_t index = (height - 1) * FIXED_BOX_MAX_SIZE + (width - 1);
+        std::call_once(built[index], [&] { basis[index] = closedFormNullspace(width, height); });
+        return basis[index];
+    }
+}
+
+//================================================================================
+// Function: solveFixedClosedForm
+// Description:
+//     solveClosedForm for boxes up to FIXED_BOX_MAX_SIZE on both sides, with
+//     the shared nullspace of the size filled in. target is row-major with
+//     values in 0..2.
+//================================================================================
+inline SolveResult solveFixedClosedForm(uint32_t width, uint32_t height, const std::vector<int> &target)
+{
+    size_t cells = static_cast<size_t>(width) * height;
+
+    SolveResult result;
+    result.nullity = closedFormNullity(width, height);
+    result.rank = static_cast<uint32_t>(cells - result.nullity);
+    result.nullspace = fixed_closed_form_detail::nullspace(width, height);
+    result.solution.resize(cells);
+    if (!fixed_closed_form_detail::solveLines(target.data(), result.solution.data(), width, height))
+    {
+        result.solution.clear();
+        return result;
+    }
+    result.solvable = true;
+    return result;
+}
+
+//================================================================================
+// Function: solveFixedClosedForm
+// Description:
+//     The same solve into caller-provided storage: target and toggles hold
+//     width·height values, row-major, so a caller can keep both on the
+//     stack. Returns false when target is not in the range of the operator.
+//================================================================================
+inline bool solveFixedClosedForm(uint32_t width, uint32_t height, const int *target, int *toggles)
+{
+    return fixed_closed_form_detail::solveLines(target, toggles, width, height);
+}
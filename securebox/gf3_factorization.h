@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "m4ri_solver.h"
+#include "packed_gf3.h"
+#include "solve_result.h"
+
+//================================================================================
+// Class: GF3Factorization
+// Description:
+//     Elimination of an effect matrix A, done once and reused for any target.
+//     Gauss-Jordan on [A | I] turns the identity block into a transform T
+//     with T·A = RREF(A). Solving A x = b is then c = T·b:
+//         - pivot row i of the RREF gives x[pivotColumn(i)] = c_i (free
+//           unknowns are 0, the same choice solvePackedLinearSystem makes)
+//         - every other row of T is in the left nullspace of A, so b is in
+//           the range exactly when c_i = 0 on all of them
+//     T is stored bitsliced with the pivot rows first, which makes one solve
+//     n dot products of 2n bits, O(n²/64) word operations.
+//
+//     The words of T either belong to the object or live in memory owned by
+//     someone else (a file mapping, see factorization_store.h) that the
+//     object keeps alive.
+//================================================================================
+class GF3Factorization
+{
+private:
+    size_t rowCount = 0, unknowns = 0, wordCount = 0;
+    std::vector<size_t> pivotColumn; // of transform row i, for i < rank()
+    std::vector<uint64_t> ownedWords;
+    std::shared_ptr<const void> backing;
+    const uint64_t *transform = nullptr; // row i: ones plane, then twos plane
+
+    // Σ a_i b_i mod 3 of two bitsliced rows
+    static uint8_t dot(const uint64_t *a1, const uint64_t *a2, const uint64_t *b1, const uint64_t *b2, size_t words)
+    {
+        uint64_t same = 0, opposite = 0; // products that are 1 and 2
+        for (size_t w = 0; w < words; ++w)
+        {
+            same += gf3::popCount(a1[w] & b1[w]) + gf3::popCount(a2[w] & b2[w]);
+            opposite += gf3::popCount(a1[w] & b2[w]) + gf3::popCount(a2[w] & b1[w]);
+        }
+        return static_cast<uint8_t>((same + 2 * opposite) % 3);
+    }
+
+    // [A | I] with the identity starting at word matrix.words()
+    static PackedGF3Matrix withIdentity(const PackedGF3Matrix &matrix)
+    {
+        size_t n = matrix.rows();
+        size_t leftWords = matrix.words();
+
+        PackedGF3Matrix augmented(n, leftWords * 64 + n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::copy(matrix.ones(i), matrix.ones(i) + leftWords, augmented.ones(i));
+            std::copy(matrix.twos(i), matrix.twos(i) + leftWords, augmented.twos(i));
+            augmented.set(i, leftWords * 64 + i, 1);
+        }
+        return augmented;
+    }
+
+    // Eliminates [A | I] and keeps T, pivot rows first
+    void factor(PackedGF3Matrix augmented, size_t leftWords, WorkerPool *pool)
+    {
+        size_t n = rowCount;
+        std::vector<size_t> pivotOf = eliminatePackedM4RI(augmented, unknowns, 0, pool);
+
+        // Pivot rows first, then the left nullspace rows
+        std::vector<size_t> order;
+        for (size_t i = 0; i < n; ++i)
+            if (pivotOf[i] < unknowns)
+            {
+                order.push_back(i);
+                pivotColumn.push_back(pivotOf[i]);
+            }
+        for (size_t i = 0; i < n; ++i)
+            if (pivotOf[i] >= unknowns)
+                order.push_back(i);
+
+        ownedWords.resize(n * 2 * wordCount);
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint64_t *row = &ownedWords[i * 2 * wordCount];
+            std::copy(augmented.ones(order[i]) + leftWords, augmented.ones(order[i]) + leftWords + wordCount, row);
+            std::copy(augmented.twos(order[i]) + leftWords, augmented.twos(order[i]) + leftWords + wordCount,
+                      row + wordCount);
+        }
+        transform = ownedWords.data();
+    }
+
+public:
+    GF3Factorization() = default;
+
+    GF3Factorization(const GF3Factorization &) = delete;
+    GF3Factorization &operator=(const GF3Factorization &) = delete;
+    GF3Factorization(GF3Factorization &&) = default; // moving the vector keeps transform valid
+    GF3Factorization &operator=(GF3Factorization &&) = default;
+
+    //================================================================================
+    // Constructor: GF3Factorization
+    // Description:
+    //     Eliminates [A | I] with eliminatePackedM4RI. The identity starts on
+    //     a word boundary, so T can be copied out word by word. Passing A as
+    //     an rvalue frees it once [A | I] is built, which takes its size off
+    //     the peak: [A | I] is twice as large, and T is copied out of it
+    //     before it is freed, so the peak is [A | I] plus one more matrix of
+    //     A's size (or the M4RI table, if larger).
+    //================================================================================
+    explicit GF3Factorization(const PackedGF3Matrix &matrix, WorkerPool *pool = nullptr)
+        : rowCount(matrix.rows()), unknowns(matrix.cols()), wordCount(gf3::wordsFor(matrix.rows()))
+    {
+        factor(withIdentity(matrix), matrix.words(), pool);
+    }
+
+    explicit GF3Factorization(PackedGF3Matrix &&matrix, WorkerPool *pool = nullptr)
+        : rowCount(matrix.rows()), unknowns(matrix.cols()), wordCount(gf3::wordsFor(matrix.rows()))
+    {
+        size_t leftWords = matrix.words();
+        PackedGF3Matrix augmented = withIdentity(matrix);
+        matrix = PackedGF3Matrix();
+        factor(std::move(augmented), leftWords, pool);
+    }
+
+    //================================================================================
+    // Method: fromMemory
+    // Description:
+    //     Factorization over an existing transform of rows × 2·wordsFor(rows)
+    //     words in the layout of transformWords(). owner is kept alive for as
+    //     long as the factorization exists.
+    //================================================================================
+    static GF3Factorization fromMemory(size_t rows, size_t cols, std::vector<size_t> pivots, const uint64_t *words,
+                                       std::shared_ptr<const void> owner)
+    {
+        GF3Factorization factorization;
+        factorization.rowCount = rows;
+        factorization.unknowns = cols;
+        factorization.wordCount = gf3::wordsFor(rows);
+        factorization.pivotColumn = std::move(pivots);
+        factorization.backing = std::move(owner);
+        factorization.transform = words;
+        return factorization;
+    }
+
+    size_t rows() const { return rowCount; }
+    size_t cols() const { return unknowns; }
+    size_t rank() const { return pivotColumn.size(); }
+    uint32_t nullity() const { return static_cast<uint32_t>(unknowns - rank()); }
+
+    const std::vector<size_t> &pivotColumns() const { return pivotColumn; }
+    const uint64_t *transformWords() const { return transform; }
+    size_t transformWordCount() const { return rowCount * 2 * wordCount; }
+
+    //================================================================================
+    // Method: solve
+    // Description:
+    //     Same result as solvePackedLinearSystem on the factored matrix, except
+    //     for the nullspace, which is not kept.
+    //================================================================================
+    SolveResult solve(const std::vector<int> &target) const
+    {
+        size_t n = rows();
+
+        PackedGF3Matrix b(1, n);
+        for (size_t i = 0; i < n; ++i)
+            b.set(0, i, ((target[i] % 3) + 3) % 3);
+
+        auto product = [&](size_t row) {
+            const uint64_t *t1 = transform + row * 2 * wordCount;
+            return dot(t1, t1 + wordCount, b.ones(0), b.twos(0), wordCount);
+        };
+
+        SolveResult result;
+        result.rank = static_cast<uint32_t>(rank());
+        result.nullity = nullity();
+        for (size_t i = rank(); i < n; ++i)
+            if (product(i) != 0)
+                return result;
+
+        result.solution.assign(unknowns, 0);
+        for (size_t i = 0; i < rank(); ++i)
+            result.solution[pivotColumn[i]] = product(i);
+
+        result.solvable = true;
+        return result;
+    }
+};
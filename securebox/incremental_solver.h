@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packed_gf3.h"
+#include "secure_box.h"
+
+//================================================================================
+// Class: IncrementalSolver
+// Description:
+//     Keeps the toggles still needed to unlock a box while the box changes.
+//     With plan p solving A p = b for the current target b, a toggle at
+//     (x, y) changes the state by A e_xy and therefore the target by
+//     -A e_xy, so
+//
+//         A (p - e_xy) = b - A e_xy
+//
+//     and the new plan is p with one toggle fewer at (x, y), mod 3. That
+//     holds for planned and external toggles alike and for every linear
+//     toggle rule, singular or not, so toggled() is O(1) and never
+//     re-solves anything.
+//
+//     Cells with toggles left are tracked in a bitset with one summary bit
+//     per bitset word, so nextMove() finds the first one (row-major) with
+//     two count-trailing-zeros per 4096 cells.
+//================================================================================
+class IncrementalSolver
+{
+private:
+    uint32_t xSize = 0, ySize = 0;
+    std::vector<uint8_t> plan;     // toggles left per cell, 0..2
+    std::vector<uint64_t> pending; // bit per cell with plan != 0
+    std::vector<uint64_t> summary; // bit per pending word != 0
+    uint64_t toggleCount = 0;
+
+    void mark(size_t cell)
+    {
+        size_t word = cell >> 6;
+        if (plan[cell])
+            pending[word] |= uint64_t(1) << (cell & 63);
+        else
+            pending[word] &= ~(uint64_t(1) << (cell & 63));
+
+        if (pending[word])
+            summary[word >> 6] |= uint64_t(1) << (word & 63);
+        else
+            summary[word >> 6] &= ~(uint64_t(1) << (word & 63));
+    }
+
+public:
+    //================================================================================
+    // Constructor: IncrementalSolver
+    // Description:
+    //     Starts from any solution of the current box (row-major toggle
+    //     counts, e.g. SolveResult::solution).
+    //================================================================================
+    IncrementalSolver(uint32_t width, uint32_t height, const std::vector<int> &solution)
+        : xSize(width), ySize(height), plan(static_cast<size_t>(width) * height, 0),
+          pending(gf3::wordsFor(plan.size()), 0), summary(gf3::wordsFor(pending.size()), 0)
+    {
+        for (size_t cell = 0; cell < plan.size(); ++cell)
+        {
+            plan[cell] = static_cast<uint8_t>(((solution[cell] % 3) + 3) % 3);
+            toggleCount += plan[cell];
+            mark(cell);
+        }
+    }
+
+    //================================================================================
+    // Method: toggled
+    // Description:
+    //     Records that toggle(x, y) was applied times times to the box, as
+    //     part of the plan or not.
+    //================================================================================
+    void toggled(uint32_t x, uint32_t y, int times = 1)
+    {
+        size_t cell = static_cast<size_t>(y) * xSize + x;
+        uint8_t before = plan[cell];
+        plan[cell] = static_cast<uint8_t>((before + 3 * 3 - times % 3) % 3);
+        toggleCount = toggleCount - before + plan[cell];
+        mark(cell);
+    }
+
+    uint32_t width() const { return xSize; }
+    uint32_t height() const { return ySize; }
+    bool solved() const { return toggleCount == 0; }
+    uint64_t remaining() const { return toggleCount; }
+    const std::vector<uint8_t> &solution() const { return plan; }
+
+    //================================================================================
+    // Method: nextMove
+    // Description:
+    //     First cell (row-major) that still needs toggles; false when the plan
+    //     is done.
+    //================================================================================
+    bool nextMove(Move &move) const
+    {
+        for (size_t s = 0; s < summary.size(); ++s)
+        {
+            if (!summary[s])
+                continue;
+            size_t word = s * 64 + gf3::countTrailingZeros(summary[s]);
+            size_t cell = word * 64 + gf3::countTrailingZeros(pending[word]);
+            move = {static_cast<int>(cell % xSize), static_cast<int>(cell / xSize), plan[cell]};
+            return true;
+        }
+        return false;
+    }
+};
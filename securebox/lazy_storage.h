@@ -0,0 +1,232 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "box_storage.h"
+
+//================================================================================
+// Class: LazyStorage
+// Description:
+//     Storage adapter that defers row and column increments. A toggle only
+//     bumps a per-row counter, a per-column counter and a sparse per-cell
+//     correction, so it costs O(1) instead of O(W + H). The real value of a
+//     cell is
+//
+//         inner(x, y) + rowOffset[y] + colOffset[x] + correction(x, y)  (mod 3)
+//
+//     and is materialized on demand by get(), or for the whole grid by
+//     flush() in a single O(W·H) pass through the inner storage. Cell
+//     increments while nothing is pending go straight to the inner storage,
+//     so per-cell passes after a flush() never fill the correction map. The
+//     map is flushed on its own once it holds W·H / CORRECTION_FLUSH_RATIO
+//     cells, which bounds it to well under a byte per cell and keeps the
+//     flush amortized O(CORRECTION_FLUSH_RATIO) per correction.
+//================================================================================
+template <typename Inner>
+class LazyStorage
+{
+private:
+    static constexpr uint64_t CORRECTION_FLUSH_RATIO = 64;
+
+    Inner inner;
+    uint32_t xSize = 0, ySize = 0;
+    std::vector<uint8_t> rowOffset, colOffset;
+    std::unordered_map<uint64_t, uint8_t> corrections; // key: y * width + x
+    bool pending = false;
+    ByteMirror mirror;
+    mutable std::array<uint64_t, 3> mirrorCounts{}; // histogram of the mirror, set with it
+
+    uint8_t correction(uint32_t x, uint32_t y) const
+    {
+        if (corrections.empty())
+            return 0;
+        auto it = corrections.find(static_cast<uint64_t>(y) * xSize + x);
+        return it == corrections.end() ? 0 : it->second;
+    }
+
+public:
+    explicit LazyStorage(Inner storage = Inner()) : inner(std::move(storage)) {}
+
+    static const char *name()
+    {
+        static const std::string lazyName = std::string("lazy ") + Inner::name();
+        return lazyName.c_str();
+    }
+
+    void resize(uint32_t width, uint32_t height)
+    {
+        mirror.invalidate();
+        xSize = width;
+        ySize = height;
+        inner.resize(width, height);
+        rowOffset.assign(height, 0);
+        colOffset.assign(width, 0);
+        corrections.clear();
+        pending = false;
+    }
+
+    uint8_t get(uint32_t x, uint32_t y) const
+    {
+        if (!pending)
+            return inner.get(x, y);
+        return (inner.get(x, y) + rowOffset[y] + colOffset[x] + correction(x, y)) % 3;
+    }
+
+    void incrementRow(uint32_t y)
+    {
+        mirror.invalidate();
+        rowOffset[y] = (rowOffset[y] + 1) % 3;
+        pending = true;
+    }
+
+    void incrementColumn(uint32_t x)
+    {
+        mirror.invalidate();
+        colOffset[x] = (colOffset[x] + 1) % 3;
+        pending = true;
+    }
+
+    void increment(uint32_t x, uint32_t y, uint8_t amount)
+    {
+        mirror.invalidate();
+        if (!pending)
+        {
+            inner.increment(x, y, amount);
+            return;
+        }
+        uint8_t &value = corrections[static_cast<uint64_t>(y) * xSize + x];
+        value = (value + amount) % 3;
+        pending = true;
+        if (corrections.size() * CORRECTION_FLUSH_RATIO > static_cast<uint64_t>(xSize) * ySize)
+            flush();
+    }
+
+    void addOffsets(const uint8_t *rowOffsets, const uint8_t *colOffsets)
+    {
+        mirror.invalidate();
+        for (uint32_t y = 0; y < ySize; ++y)
+            rowOffset[y] = (rowOffset[y] + rowOffsets[y]) % 3;
+        for (uint32_t x = 0; x < xSize; ++x)
+            colOffset[x] = (colOffset[x] + colOffsets[x]) % 3;
+        pending = true;
+    }
+
+    //================================================================================
+    // Method: anyNonZero / histogram
+    // Description:
+    //     O(1) through the inner storage once flushed. With updates pending the
+    //     counts are not known without looking at every cell; they are taken
+    //     while view() decodes the mirror and kept with it, so every call until
+    //     the next change is O(1) and a display of the same state reuses the
+    //     pass.
+    //================================================================================
+    bool anyNonZero() const
+    {
+        if (!pending)
+            return inner.anyNonZero();
+        view();
+        return mirrorCounts[1] + mirrorCounts[2] != 0;
+    }
+
+    std::array<uint64_t, 3> histogram() const
+    {
+        if (!pending)
+            return inner.histogram();
+        view();
+        return mirrorCounts;
+    }
+
+    //================================================================================
+    // Method: view
+    // Description:
+    //     Views the inner storage directly when nothing is pending, otherwise
+    //     materializes inner + offsets + corrections into a reused mirror
+    //     without flushing, and counts its values for histogram().
+    //================================================================================
+    StateView view() const
+    {
+        if (!pending)
+            return inner.view();
+
+        StateView base = inner.view();
+        return mirror.view(
+            xSize, ySize,
+            [&](uint32_t y, uint8_t *out) {
+                const uint8_t *row = base.row(y);
+                for (uint32_t x = 0; x < xSize; ++x)
+                    out[x] = (row[x] + rowOffset[y] + colOffset[x]) % 3;
+            },
+            [&](uint8_t *cells) {
+                // Corrections are sparse, patch them in after the row pass
+                for (const auto &entry : corrections)
+                    cells[entry.first] = (cells[entry.first] + entry.second) % 3;
+                mirrorCounts = {0, 0, 0};
+                size_t total = static_cast<size_t>(xSize) * ySize;
+                for (size_t i = 0; i < total; ++i)
+                    ++mirrorCounts[cells[i]];
+            });
+    }
+
+    //================================================================================
+    // Method: lineSums
+    // Description:
+    //     Sums of the inner storage plus the pending updates: row y gains
+    //     W·rowOffset[y] + ΣcolOffset, column x gains H·colOffset[x] + ΣrowOffset,
+    //     and every correction counts once for its row and its column.
+    //================================================================================
+    void lineSums(uint8_t *rowSum, uint8_t *colSum) const
+    {
+        inner.lineSums(rowSum, colSum);
+        if (!pending)
+            return;
+
+        uint32_t rowOffsetSum = 0, colOffsetSum = 0;
+        for (uint32_t y = 0; y < ySize; ++y)
+            rowOffsetSum += rowOffset[y];
+        for (uint32_t x = 0; x < xSize; ++x)
+            colOffsetSum += colOffset[x];
+
+        for (uint32_t y = 0; y < ySize; ++y)
+            rowSum[y] = (rowSum[y] + (xSize % 3) * rowOffset[y] + colOffsetSum) % 3;
+        for (uint32_t x = 0; x < xSize; ++x)
+            colSum[x] = (colSum[x] + (ySize % 3) * colOffset[x] + rowOffsetSum) % 3;
+        for (const auto &entry : corrections)
+        {
+            uint32_t y = static_cast<uint32_t>(entry.first / xSize);
+            uint32_t x = static_cast<uint32_t>(entry.first % xSize);
+            rowSum[y] = (rowSum[y] + entry.second) % 3;
+            colSum[x] = (colSum[x] + entry.second) % 3;
+        }
+    }
+
+    //================================================================================
+    // Method: flush
+    // Description:
+    //     Applies every deferred row and column update to the inner storage in
+    //     one addOffsets() pass, then the sparse cell corrections, and resets
+    //     the accumulators.
+    //================================================================================
+    void flush()
+    {
+        if (!pending)
+            return;
+
+        mirror.invalidate();
+        inner.addOffsets(rowOffset.data(), colOffset.data());
+        rowOffset.assign(ySize, 0);
+        colOffset.assign(xSize, 0);
+        for (const auto &entry : corrections)
+        {
+            if (entry.second != 0)
+                inner.increment(static_cast<uint32_t>(entry.first % xSize),
+                                static_cast<uint32_t>(entry.first / xSize), entry.second);
+        }
+        corrections.clear();
+        pending = false;
+    }
+};
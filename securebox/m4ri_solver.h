@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packed_solver.h"
+#include "worker_pool.h"
+
+//================================================================================
+// Method of Four Russians elimination over GF(3)
+//================================================================================
+// M4RI-style variant of eliminatePacked. Rows are processed in panels of k
+// pivots: the panel rows are reduced against each other (pivot value 1,
+// every pivot column zero in the other panel rows), then a table of all 3^k
+// combinations
+//
+//     T[d_0 + 3 d_1 + 9 d_2 + ...] = d_0 P_0 + d_1 P_1 + ...
+//
+// is built with one row add per entry. Clearing the k pivot columns from any
+// other row is then a single add of T[index] with index read off that row's
+// k pivot coefficients (negated), instead of k separate row operations.
+//
+// The table is applied in column stripes sized so that one stripe of all 3^k
+// entries stays in cache while every row streams past it. k grows with the
+// row count so that building the table (3^k adds) stays small next to
+// applying it (one add per row).
+//================================================================================
+
+namespace m4ri_detail
+{
+    constexpr size_t MAX_K = 6;               // 729 table rows
+    constexpr size_t CACHE_BYTES = 256 * 1024; // L2 share one stripe of the table may use
+
+    inline size_t power3(size_t k)
+    {
+        size_t p = 1;
+        while (k--)
+            p *= 3;
+        return p;
+    }
+}
+
+//================================================================================
+// Function: m4riBlockSize
+// Description:
+//     Panel size for a matrix with rows rows: the largest k ≤ MAX_K with
+//     3^k ≤ rows / 32, at least 1.
+//================================================================================
+inline size_t m4riBlockSize(size_t rows)
+{
+    size_t k = 1;
+    while (k < m4ri_detail::MAX_K && m4ri_detail::power3(k + 1) * 32 <= rows)
+        ++k;
+    return k;
+}
+
+//================================================================================
+// Function: eliminatePackedM4RI
+// Description:
+//     Same result as eliminatePacked. k = 0 picks m4riBlockSize(rows); the
+//     table application is split over pool when one is given.
+//================================================================================
+inline std::vector<size_t> eliminatePackedM4RI(PackedGF3Matrix &matrix, size_t pivotCols, size_t k = 0,
+                                               WorkerPool *pool = nullptr)
+{
+    using m4ri_detail::power3;
+
+    size_t n = matrix.rows();
+    size_t words = matrix.words();
+    std::vector<size_t> pivotOf(n, matrix.cols());
+    if (k == 0)
+        k = m4riBlockSize(n);
+    k = std::min(std::max<size_t>(k, 1), m4ri_detail::MAX_K);
+
+    std::vector<size_t> panelRows;
+    std::vector<uint64_t> table;
+    std::vector<uint16_t> index(n);
+
+    for (size_t start = 0; start < n;)
+    {
+        // Panel: the next rows until k pivots were found, reduced against each other
+        panelRows.clear();
+        size_t end = start;
+        for (; end < n && panelRows.size() < k; ++end)
+        {
+            for (size_t p : panelRows)
+            {
+                size_t pw = pivotOf[p] >> 6;
+                uint64_t pb = uint64_t(1) << (pivotOf[p] & 63);
+                if (matrix.ones(end)[pw] & pb)
+                    matrix.subRow(end, p, pw);
+                else if (matrix.twos(end)[pw] & pb)
+                    matrix.addRow(end, p, pw);
+            }
+
+            size_t col = matrix.leadingColumn(end);
+            if (col >= pivotCols)
+                continue;
+
+            pivotOf[end] = col;
+            if (matrix.get(end, col) == 2)
+                matrix.negateRow(end);
+
+            size_t word = col >> 6;
+            uint64_t bit = uint64_t(1) << (col & 63);
+            for (size_t j = start; j < end; ++j)
+            {
+                if (matrix.ones(j)[word] & bit)
+                    matrix.subRow(j, end, word);
+                else if (matrix.twos(j)[word] & bit)
+                    matrix.addRow(j, end, word);
+            }
+            panelRows.push_back(end);
+        }
+        size_t panelStart = start;
+        start = end;
+        if (panelRows.empty())
+            continue;
+
+        // Panel rows are zero before their own pivot word
+        size_t firstWord = words;
+        for (size_t p : panelRows)
+            firstWord = std::min(firstWord, pivotOf[p] >> 6);
+        size_t width = words - firstWord;
+        size_t entries = power3(panelRows.size());
+
+        // T[index] for every combination, ones plane then twos plane per entry
+        table.assign(entries * 2 * width, 0);
+        for (size_t j = 0, step = 1; j < panelRows.size(); ++j, step *= 3)
+        {
+            const uint64_t *p1 = matrix.ones(panelRows[j]) + firstWord;
+            const uint64_t *p2 = matrix.twos(panelRows[j]) + firstWord;
+            for (size_t idx = 0; idx < step; ++idx)
+            {
+                const uint64_t *s1 = &table[idx * 2 * width], *s2 = s1 + width;
+                uint64_t *once1 = &table[(idx + step) * 2 * width], *once2 = once1 + width;
+                uint64_t *twice1 = &table[(idx + 2 * step) * 2 * width], *twice2 = twice1 + width;
+                for (size_t w = 0; w < width; ++w)
+                {
+                    gf3::add(s1[w], s2[w], p1[w], p2[w], once1[w], once2[w]);
+                    gf3::sub(s1[w], s2[w], p1[w], p2[w], twice1[w], twice2[w]); // + 2P = - P
+                }
+            }
+        }
+
+        // Table index of every other row: the negated pivot coefficients in base 3
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint32_t idx = 0;
+            if (i < panelStart || i >= end)
+            {
+                for (size_t j = panelRows.size(); j-- > 0;)
+                    idx = idx * 3 + (3 - matrix.get(i, pivotOf[panelRows[j]])) % 3;
+            }
+            index[i] = static_cast<uint16_t>(idx);
+        }
+
+        // Apply stripe by stripe, so one stripe of the whole table stays cached
+        size_t stripe = std::max<size_t>(1, m4ri_detail::CACHE_BYTES / (entries * 2 * sizeof(uint64_t)));
+        auto apply = [&](size_t begin, size_t stop) {
+            for (size_t from = 0; from < width; from += stripe)
+            {
+                size_t to = std::min(width, from + stripe);
+                for (size_t i = begin; i < stop; ++i)
+                {
+                    if (index[i] == 0)
+                        continue;
+                    uint64_t *r1 = matrix.ones(i) + firstWord, *r2 = matrix.twos(i) + firstWord;
+                    const uint64_t *t1 = &table[index[i] * 2 * width], *t2 = t1 + width;
+                    for (size_t w = from; w < to; ++w)
+                        gf3::add(r1[w], r2[w], t1[w], t2[w], r1[w], r2[w]);
+                }
+            }
+        };
+
+        if (pool)
+            pool->run([&](unsigned worker) {
+                auto slice = pool->range(n, worker);
+                apply(slice.first, slice.second);
+            });
+        else
+            apply(0, n);
+    }
+
+    return pivotOf;
+}
+
+//================================================================================
+// Function: solvePackedLinearSystemM4RI
+// Description:
+//     solvePackedLinearSystem on top of eliminatePackedM4RI.
+//================================================================================
+inline SolveResult solvePackedLinearSystemM4RI(const PackedGF3Matrix &matrix, const std::vector<int> &target,
+                                               size_t k = 0, WorkerPool *pool = nullptr)
+{
+    PackedGF3Matrix augmented = packed_detail::augment(matrix, target);
+    std::vector<size_t> pivotOf = eliminatePackedM4RI(augmented, matrix.cols(), k, pool);
+    return packed_detail::readSolution(augmented, pivotOf, matrix.cols());
+}
+
+//================================================================================
+// Function: solveBatchM4RI
+// Description:
+//     solveBatch on top of eliminatePackedM4RI.
+//================================================================================
+inline std::vector<SolveResult> solveBatchM4RI(const PackedGF3Matrix &matrix,
+                                               const std::vector<std::vector<int>> &targets, size_t k = 0,
+                                               WorkerPool *pool = nullptr)
+{
+    PackedGF3Matrix augmented = packed_detail::augmentBatch(matrix, targets);
+    std::vector<size_t> pivotOf = eliminatePackedM4RI(augmented, matrix.cols(), k, pool);
+    return packed_detail::readBatch(augmented, pivotOf, matrix.cols(), targets.size());
+}
@@ -0,0 +1,531 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "box_storage.h"
+
+//================================================================================
+// Mapped grid file layout (little endian)
+//================================================================================
+//
+//     offset  size  field
+//     0       8     magic        "SECUREBX"
+//     8       4     version      2
+//     12      4     headerSize   64
+//     16      4     width
+//     20      4     height
+//     24      8     rowWords     64-bit words per row, (width + 31) / 32
+//     32      32    reserved     0
+//     4096    ...   rows         height × rowWords words of 2-bit trits,
+//                                cell x of a row in bits 2·(x % 32) of word x / 32
+//
+// The trit encoding is the one of PackedStorage. Rows start at a page
+// boundary so a whole-grid pass can be advised separately from the header.
+//
+// The file is scratch space for a single run: it is recreated whenever a box
+// is, and never opened again. The header only marks it as a grid file (so it
+// may be replaced without --overwrite) and lets the rows be read by other
+// tools after a flush(). The cell histogram lives in memory only.
+//================================================================================
+
+namespace mapped_detail
+{
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t width;
+        uint32_t height;
+        uint64_t rowWords;
+        uint64_t reserved[4];
+    };
+    static_assert(sizeof(Header) == 64, "mapped header layout changed");
+
+    constexpr char MAGIC[8] = {'S', 'E', 'C', 'U', 'R', 'E', 'B', 'X'};
+    constexpr uint32_t VERSION = 2;
+    constexpr size_t DATA_OFFSET = 4096;
+
+    //================================================================================
+    // Function: holdsOtherData
+    // Description:
+    //     Whether path is a non-empty file that does not start with MAGIC,
+    //     i.e. something other than a grid file that creating a grid there
+    //     would destroy. A missing or unreadable file is left to create(),
+    //     which reports it.
+    //================================================================================
+    inline bool holdsOtherData(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        char magic[sizeof(MAGIC)];
+        in.read(magic, sizeof(magic));
+        if (in.gcount() == 0)
+            return false;
+        return in.gcount() != static_cast<std::streamsize>(sizeof(magic)) ||
+               std::memcmp(magic, MAGIC, sizeof(magic)) != 0;
+    }
+
+    //================================================================================
+    // Class: FileMapping
+    // Description:
+    //     Read/write mapping of a whole file, created (or truncated) at a given
+    //     size, or read-only mapping of an existing one. Throws
+    //     std::runtime_error when the file cannot be created, opened or
+    //     mapped. advise() is a hint only and does nothing where unsupported.
+    //================================================================================
+    class FileMapping
+    {
+    public:
+        enum class Access
+        {
+            Normal,
+            Sequential,
+        };
+
+    private:
+        uint8_t *base = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
+
+    public:
+        FileMapping() = default;
+        FileMapping(const FileMapping &) = delete;
+        FileMapping &operator=(const FileMapping &) = delete;
+
+        FileMapping(FileMapping &&other) noexcept { *this = std::move(other); }
+
+        FileMapping &operator=(FileMapping &&other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                std::swap(base, other.base);
+                std::swap(length, other.length);
+#ifdef _WIN32
+                std::swap(file, other.file);
+                std::swap(mapping, other.mapping);
+#endif
+            }
+            return *this;
+        }
+
+        ~FileMapping() { close(); }
+
+        void create(const std::string &path, size_t size)
+        {
+            close();
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                throw std::runtime_error("cannot create " + path);
+            uint64_t size64 = size;
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+                                         static_cast<DWORD>(size64), nullptr);
+            if (!mapping)
+            {
+                close();
+                throw std::runtime_error("cannot map " + path);
+            }
+            base = static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+            if (!base)
+            {
+                close();
+                throw std::runtime_error("cannot map " + path);
+            }
+#else
+            int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+                throw std::runtime_error("cannot create " + path);
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("cannot resize " + path);
+            }
+            void *address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd); // the mapping keeps the file open
+            if (address == MAP_FAILED)
+                throw std::runtime_error("cannot map " + path);
+            base = static_cast<uint8_t *>(address);
+#endif
+            length = size;
+        }
+
+        //================================================================================
+        // Method: openReadOnly
+        // Description:
+        //     Maps an existing file for reading. Other processes may keep
+        //     reading, replacing or deleting it meanwhile.
+        //================================================================================
+        void openReadOnly(const std::string &path)
+        {
+            close();
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                throw std::runtime_error("cannot open " + path);
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            {
+                close();
+                throw std::runtime_error("cannot map " + path);
+            }
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping)
+            {
+                close();
+                throw std::runtime_error("cannot map " + path);
+            }
+            base = static_cast<uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (!base)
+            {
+                close();
+                throw std::runtime_error("cannot map " + path);
+            }
+            length = static_cast<size_t>(fileSize.QuadPart);
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("cannot open " + path);
+            off_t size = ::lseek(fd, 0, SEEK_END);
+            if (size <= 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            void *address = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (address == MAP_FAILED)
+                throw std::runtime_error("cannot map " + path);
+            base = static_cast<uint8_t *>(address);
+            length = static_cast<size_t>(size);
+#endif
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (base)
+                UnmapViewOfFile(base);
+            if (mapping)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (base)
+                ::munmap(base, length);
+#endif
+            base = nullptr;
+            length = 0;
+        }
+
+        //================================================================================
+        // Method: advise
+        // Description:
+        //     Access pattern hint for [offset, offset + size). madvise on POSIX,
+        //     nothing on Windows, where the cache manager detects sequential
+        //     reads on its own.
+        //================================================================================
+        void advise(size_t offset, size_t size, Access access) const
+        {
+#ifndef _WIN32
+            if (!base || size == 0)
+                return;
+            size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+            size_t start = offset / page * page;
+            ::madvise(base + start, offset + size - start,
+                      access == Access::Sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+#else
+            (void)offset;
+            (void)size;
+            (void)access;
+#endif
+        }
+
+        //================================================================================
+        // Method: sync
+        // Description:
+        //     Starts writing dirty pages back to the file without waiting.
+        //================================================================================
+        void sync() const
+        {
+            if (!base)
+                return;
+#ifdef _WIN32
+            FlushViewOfFile(base, 0);
+#else
+            ::msync(base, length, MS_ASYNC);
+#endif
+        }
+
+        uint8_t *data() const { return base; }
+        size_t size() const { return length; }
+    };
+}
+
+//================================================================================
+// Class: MappedStorage
+// Description:
+//     PackedStorage layout kept in a memory-mapped file instead of RAM, for
+//     boxes that do not fit in memory. The OS pages rows in and out: a row
+//     increment streams through the pages of that row, a column increment
+//     touches one word per row. Whole-grid passes (addOffsets, lineSums,
+//     view) are advised as sequential while they run.
+//
+//     The cell histogram is kept in memory like every other storage, so
+//     isLocked() stays O(1) and never has to page the grid in. The file is
+//     scratch space, see the layout above; flush() starts the write-back.
+//
+//     The file path is given at construction:
+//         SecureBox<MappedStorage> box(x, y, MappedStorage("box.grid"));
+//     An existing file there is only replaced when it is a grid file (or
+//     empty), unless overwrite is set, so a mistyped path cannot truncate
+//     unrelated data.
+//================================================================================
+class MappedStorage
+{
+private:
+    static constexpr uint64_t LOW_BITS = 0x5555555555555555ull;
+
+    std::string path;
+    bool overwrite = false;
+    mapped_detail::FileMapping file;
+    uint64_t *words = nullptr;
+    uint32_t xSize = 0, ySize = 0;
+    size_t rowWords = 0;
+    uint64_t lastWordMask = 0;
+    CellHistogram counts;
+    ByteMirror mirror;
+
+    mapped_detail::Header &header()
+    {
+        return *reinterpret_cast<mapped_detail::Header *>(file.data());
+    }
+
+    size_t gridBytes() const
+    {
+        return rowWords * ySize * sizeof(uint64_t);
+    }
+
+    //================================================================================
+    // Class: SequentialPass
+    // Description:
+    //     Advises the grid as sequential for the lifetime of the object.
+    //================================================================================
+    class SequentialPass
+    {
+    private:
+        const MappedStorage &storage;
+
+    public:
+        explicit SequentialPass(const MappedStorage &owner) : storage(owner)
+        {
+            storage.file.advise(mapped_detail::DATA_OFFSET, storage.gridBytes(),
+                                mapped_detail::FileMapping::Access::Sequential);
+        }
+
+        ~SequentialPass()
+        {
+            storage.file.advise(mapped_detail::DATA_OFFSET, storage.gridBytes(),
+                                mapped_detail::FileMapping::Access::Normal);
+        }
+    };
+
+public:
+    explicit MappedStorage(std::string filePath = "securebox.grid", bool overwriteAny = false)
+        : path(std::move(filePath)), overwrite(overwriteAny)
+    {
+    }
+
+    MappedStorage(MappedStorage &&) = default;
+    MappedStorage &operator=(MappedStorage &&) = default;
+
+    static const char *name() { return "mapped"; }
+
+    const std::string &filePath() const { return path; }
+
+    //================================================================================
+    // Method: resize
+    // Description:
+    //     Creates (or truncates) the file with a fresh header and an all-zero
+    //     grid. A new file reads as zeros, so nothing has to be written.
+    //     Throws std::runtime_error instead when the file holds something
+    //     other than a grid and overwrite is not set.
+    //================================================================================
+    void resize(uint32_t width, uint32_t height)
+    {
+        mirror.invalidate();
+        xSize = width;
+        ySize = height;
+        rowWords = (static_cast<size_t>(width) + 31) / 32;
+        uint32_t tail = width % 32;
+        lastWordMask = tail ? LOW_BITS & ((uint64_t(1) << (2 * tail)) - 1) : LOW_BITS;
+
+        if (!overwrite && !file.data() && mapped_detail::holdsOtherData(path))
+            throw std::runtime_error(path + " is not a SecureBox grid file, refusing to overwrite it");
+        file.create(path, mapped_detail::DATA_OFFSET + gridBytes());
+        words = reinterpret_cast<uint64_t *>(file.data() + mapped_detail::DATA_OFFSET);
+        counts.reset(static_cast<uint64_t>(width) * height);
+
+        mapped_detail::Header &h = header();
+        std::memcpy(h.magic, mapped_detail::MAGIC, sizeof(h.magic));
+        h.version = mapped_detail::VERSION;
+        h.headerSize = sizeof(mapped_detail::Header);
+        h.width = width;
+        h.height = height;
+        h.rowWords = rowWords;
+        std::memset(h.reserved, 0, sizeof(h.reserved));
+    }
+
+    uint8_t get(uint32_t x, uint32_t y) const
+    {
+        return (words[y * rowWords + x / 32] >> (2 * (x % 32))) & 3;
+    }
+
+    void incrementRow(uint32_t y)
+    {
+        mirror.invalidate();
+        counts.rotate(toggleKernels.incrementTrits(&words[y * rowWords], rowWords, lastWordMask), xSize);
+    }
+
+    void incrementColumn(uint32_t x)
+    {
+        mirror.invalidate();
+        uint64_t field = uint64_t(1) << (2 * (x % 32));
+        counts.rotate(toggleKernels.incrementTritColumn(&words[x / 32], rowWords, ySize, field), ySize);
+    }
+
+    void increment(uint32_t x, uint32_t y, uint8_t amount)
+    {
+        mirror.invalidate();
+        uint64_t &w = words[y * rowWords + x / 32];
+        unsigned shift = 2 * (x % 32);
+        uint64_t value = (w >> shift) & 3;
+        uint64_t next = (value + amount) % 3;
+        counts.change(static_cast<uint8_t>(value), static_cast<uint8_t>(next));
+        w ^= (value ^ next) << shift;
+    }
+
+    void addOffsets(const uint8_t *rowOffset, const uint8_t *colOffset)
+    {
+        mirror.invalidate();
+        SequentialPass pass(*this);
+
+        std::vector<uint64_t> colOnes[3], colTwos[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            colOnes[r].assign(rowWords, 0);
+            colTwos[r].assign(rowWords, 0);
+            for (uint32_t x = 0; x < xSize; ++x)
+            {
+                int v = (colOffset[x] + r) % 3;
+                uint64_t bit = uint64_t(1) << (2 * (x % 32));
+                if (v == 1)
+                    colOnes[r][x / 32] |= bit;
+                else if (v == 2)
+                    colTwos[r][x / 32] |= bit;
+            }
+        }
+
+        TritCount after;
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            uint64_t *row = &words[y * rowWords];
+            const std::vector<uint64_t> &ones = colOnes[rowOffset[y] % 3];
+            const std::vector<uint64_t> &twos = colTwos[rowOffset[y] % 3];
+            for (size_t w = 0; w < rowWords; ++w)
+            {
+                uint64_t lo = row[w] & LOW_BITS, hi = (row[w] >> 1) & LOW_BITS;
+                gf3::add(lo, hi, ones[w], twos[w], lo, hi);
+                after.ones += gf3::popCount(lo);
+                after.twos += gf3::popCount(hi);
+                row[w] = lo | (hi << 1);
+            }
+        }
+        counts.assign(static_cast<uint64_t>(xSize) * ySize, after);
+    }
+
+    bool anyNonZero() const
+    {
+        return counts.nonZero() != 0;
+    }
+
+    std::array<uint64_t, 3> histogram() const
+    {
+        return counts.values();
+    }
+
+    StateView view() const
+    {
+        SequentialPass pass(*this);
+        return mirror.view(xSize, ySize, [this](uint32_t y, uint8_t *out) {
+            const uint64_t *row = &words[y * rowWords];
+            for (uint32_t x = 0; x < xSize; ++x)
+                out[x] = (row[x / 32] >> (2 * (x % 32))) & 3;
+        });
+    }
+
+    void lineSums(uint8_t *rowSum, uint8_t *colSum) const
+    {
+        SequentialPass pass(*this);
+        std::vector<uint32_t> columns(xSize, 0);
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            const uint64_t *row = &words[y * rowWords];
+            uint32_t sum = 0;
+            for (size_t w = 0; w < rowWords; ++w)
+            {
+                uint64_t lo = row[w] & LOW_BITS, hi = (row[w] >> 1) & LOW_BITS;
+                sum += gf3::popCount(lo) + 2 * gf3::popCount(hi);
+                for (; lo; lo &= lo - 1)
+                    columns[w * 32 + gf3::countTrailingZeros(lo) / 2] += 1;
+                for (; hi; hi &= hi - 1)
+                    columns[w * 32 + gf3::countTrailingZeros(hi) / 2] += 2;
+            }
+            rowSum[y] = sum % 3;
+        }
+        for (uint32_t x = 0; x < xSize; ++x)
+            colSum[x] = columns[x] % 3;
+    }
+
+    //================================================================================
+    // Method: flush
+    // Description:
+    //     Starts writing dirty pages back, so the rows in the file are a
+    //     complete snapshot once the OS is done.
+    //================================================================================
+    void flush()
+    {
+        file.sync();
+    }
+};
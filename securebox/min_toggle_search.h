@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packed_gf3.h"
+#include "solve_result.h"
+
+//================================================================================
+// Minimum-toggle search
+//================================================================================
+// A solvable box with nullity k has 3^k toggle vectors x = p + Σ c_j N_j
+// (p the particular solution, N_j the nullspace basis, c_j in GF(3)). They all
+// unlock the box, but replaying x costs Σ x_i real toggles, a 2 being two
+// presses. The search looks for the cheapest one:
+//
+//   - k ≤ grayLimit: exhaustive. The coefficients run through a modular
+//     ternary Gray code (step s increments digit v3(s), the number of
+//     trailing zeros of s in base 3), so every step is one bitsliced add of
+//     a basis vector plus a popcount, O(3^k · n / 64) in total.
+//   - larger k: depth-first branch-and-bound over c_0, c_1, ... Cell i is
+//     final once the last basis vector touching it has its coefficient, so
+//     the cost of the finished cells is a lower bound for the subtree.
+//     A greedy descent (add a basis vector whenever it lowers the cost)
+//     provides the first upper bound. The search stops after nodeBudget
+//     nodes and keeps the best vector found so far.
+//================================================================================
+
+//================================================================================
+// Struct: ToggleSearchResult
+// Description:
+//     solution → cheapest toggle vector found, same layout as
+//                SolveResult::solution
+//     toggles  → its total toggle count
+//     optimal  → the whole coset was covered (exhaustively or by bounds)
+//     nodes    → Gray code steps or branch-and-bound nodes visited
+//================================================================================
+struct ToggleSearchResult
+{
+    std::vector<int> solution;
+    uint64_t toggles = 0;
+    bool optimal = false;
+    uint64_t nodes = 0;
+};
+
+namespace toggle_search_detail
+{
+    // Σ x_i of a bitsliced vector, 2s counting twice, over the words in mask
+    // (all words when mask is null)
+    inline uint64_t cost(const uint64_t *ones, const uint64_t *twos, const uint64_t *mask, size_t words)
+    {
+        uint64_t total = 0;
+        for (size_t w = 0; w < words; ++w)
+        {
+            uint64_t m = mask ? mask[w] : ~uint64_t(0);
+            total += gf3::popCount(ones[w] & m) + 2 * gf3::popCount(twos[w] & m);
+        }
+        return total;
+    }
+
+    // x = a + times · b, times in 0..2
+    inline void addScaled(const uint64_t *a1, const uint64_t *a2, const uint64_t *b1, const uint64_t *b2,
+                          int times, uint64_t *x1, uint64_t *x2, size_t words)
+    {
+        for (size_t w = 0; w < words; ++w)
+        {
+            if (times == 0)
+            {
+                x1[w] = a1[w];
+                x2[w] = a2[w];
+            }
+            else if (times == 1)
+                gf3::add(a1[w], a2[w], b1[w], b2[w], x1[w], x2[w]);
+            else
+                gf3::sub(a1[w], a2[w], b1[w], b2[w], x1[w], x2[w]);
+        }
+    }
+
+    //================================================================================
+    // Class: BranchAndBound
+    // Description:
+    //     State of the depth-first search. level[d] holds p + Σ_{j<d} c_j N_j,
+    //     finished[d] the cells whose last basis vector is d - 1 (finished[0]
+    //     the cells no basis vector touches).
+    //================================================================================
+    class BranchAndBound
+    {
+    private:
+        const PackedGF3Matrix &basis;
+        size_t words;
+        uint64_t budget;
+        std::vector<std::vector<uint64_t>> level;    // 2 · words per depth
+        std::vector<std::vector<uint64_t>> finished; // words per depth
+
+    public:
+        std::vector<uint64_t> best; // 2 · words
+        uint64_t bestCost;
+        uint64_t nodes = 0;
+
+        BranchAndBound(const PackedGF3Matrix &nullspace, const std::vector<uint64_t> &start,
+                       const std::vector<uint64_t> &incumbent, uint64_t nodeBudget)
+            : basis(nullspace), words(nullspace.words()), budget(nodeBudget),
+              level(nullspace.rows() + 1, std::vector<uint64_t>(2 * nullspace.words())),
+              finished(nullspace.rows() + 1, std::vector<uint64_t>(nullspace.words(), 0)), best(incumbent)
+        {
+            size_t k = basis.rows();
+            level[0] = start;
+            bestCost = cost(best.data(), best.data() + words, nullptr, words);
+
+            // Bit set in the word of the last basis vector touching each cell
+            std::vector<uint64_t> touched(words, 0);
+            for (size_t d = k; d-- > 0;)
+                for (size_t w = 0; w < words; ++w)
+                {
+                    uint64_t bits = (basis.ones(d)[w] | basis.twos(d)[w]) & ~touched[w];
+                    finished[d + 1][w] = bits;
+                    touched[w] |= bits;
+                }
+            for (size_t w = 0; w < words; ++w)
+                finished[0][w] = ~touched[w];
+        }
+
+        // Cost of the cells no basis vector can change
+        uint64_t rootBound() const
+        {
+            return cost(level[0].data(), level[0].data() + words, finished[0].data(), words);
+        }
+
+        // Returns false once the budget ran out
+        bool search(size_t depth, uint64_t bound)
+        {
+            if (++nodes > budget)
+                return false;
+
+            size_t k = basis.rows();
+            if (depth == k)
+            {
+                if (bound < bestCost)
+                {
+                    bestCost = bound;
+                    best = level[k];
+                }
+                return true;
+            }
+
+            // Children in order of their bound, cheapest first
+            std::vector<uint64_t> &next = level[depth + 1];
+            std::pair<uint64_t, int> children[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                addScaled(level[depth].data(), level[depth].data() + words, basis.ones(depth), basis.twos(depth), c,
+                          next.data(), next.data() + words, words);
+                children[c] = {bound + cost(next.data(), next.data() + words, finished[depth + 1].data(), words), c};
+            }
+            std::sort(children, children + 3);
+
+            for (const auto &child : children)
+            {
+                if (child.first >= bestCost)
+                    break;
+                addScaled(level[depth].data(), level[depth].data() + words, basis.ones(depth), basis.twos(depth),
+                          child.second, next.data(), next.data() + words, words);
+                if (!search(depth + 1, child.first))
+                    return false;
+            }
+            return true;
+        }
+    };
+}
+
+//================================================================================
+// Function: minimizeToggles
+// Description:
+//     Cheapest toggle vector in the solution coset of a solvable result. A
+//     result without nullspace (or with nullity 0) is returned as is, optimal
+//     only when its nullity is 0.
+//================================================================================
+inline ToggleSearchResult minimizeToggles(const SolveResult &result, uint64_t nodeBudget = 1u << 22,
+                                          uint32_t grayLimit = 12)
+{
+    using namespace toggle_search_detail;
+
+    ToggleSearchResult search;
+    search.solution = result.solution;
+    for (int value : result.solution)
+        search.toggles += value;
+    search.optimal = result.nullity == 0;
+    if (!result.solvable || result.nullity == 0 || !result.nullspace)
+        return search;
+
+    const PackedGF3Matrix &basis = *result.nullspace;
+    size_t n = result.solution.size();
+    size_t words = basis.words();
+    size_t k = basis.rows();
+
+    // Bitsliced particular solution
+    std::vector<uint64_t> start(2 * words, 0);
+    for (size_t i = 0; i < n; ++i)
+        if (result.solution[i] == 1)
+            start[i >> 6] |= uint64_t(1) << (i & 63);
+        else if (result.solution[i] == 2)
+            start[words + (i >> 6)] |= uint64_t(1) << (i & 63);
+
+    std::vector<uint64_t> best = start;
+    uint64_t bestCost = search.toggles;
+
+    if (k <= grayLimit)
+    {
+        std::vector<uint64_t> x = start;
+        uint64_t steps = 1;
+        for (size_t j = 0; j < k; ++j)
+            steps *= 3;
+        for (uint64_t s = 1; s < steps; ++s)
+        {
+            size_t digit = 0;
+            for (uint64_t v = s; v % 3 == 0; v /= 3)
+                ++digit;
+            addScaled(x.data(), x.data() + words, basis.ones(digit), basis.twos(digit), 1, x.data(),
+                      x.data() + words, words);
+            uint64_t c = cost(x.data(), x.data() + words, nullptr, words);
+            if (c < bestCost)
+            {
+                bestCost = c;
+                best = x;
+            }
+        }
+        search.nodes = steps;
+        search.optimal = true;
+    }
+    else
+    {
+        // Greedy descent for a first upper bound
+        std::vector<uint64_t> trial(2 * words);
+        for (bool improved = true; improved;)
+        {
+            improved = false;
+            for (size_t j = 0; j < k; ++j)
+                for (int times = 1; times < 3; ++times)
+                {
+                    addScaled(best.data(), best.data() + words, basis.ones(j), basis.twos(j), times, trial.data(),
+                              trial.data() + words, words);
+                    uint64_t c = cost(trial.data(), trial.data() + words, nullptr, words);
+                    if (c < bestCost)
+                    {
+                        bestCost = c;
+                        best.swap(trial);
+                        improved = true;
+                    }
+                }
+        }
+
+        BranchAndBound bnb(basis, start, best, nodeBudget);
+        bool complete = bnb.search(0, bnb.rootBound());
+        best = bnb.best;
+        bestCost = bnb.bestCost;
+        search.nodes = bnb.nodes;
+        search.optimal = complete;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t bit = uint64_t(1) << (i & 63);
+        search.solution[i] = (best[i >> 6] & bit) ? 1 : (best[words + (i >> 6)] & bit) ? 2 : 0;
+    }
+    search.toggles = bestCost;
+    return search;
+}
@@ -0,0 +1,512 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "packed_gf3.h"
+#include "packed_solver.h"
+#include "solve_result.h"
+
+//================================================================================
+// Modular solver
+//================================================================================
+// Solves effect · x = target over Z_n for a compile-time modulus n, for boxes
+// with n lock levels instead of 3. The toggle effect matrix itself does not
+// depend on n (every entry is 0 or 1), only the arithmetic does, and that is
+// picked per modulus at compile time:
+//
+//     n = 2        bit-packed rows, a row operation is a word-wise XOR
+//     n = 3        the bitsliced GF(3) path of packed_solver.h
+//     other prime  Gauss-Jordan on 32-bit residues, products reduced with
+//                  Barrett (multiply + shift, no division), inverses from a
+//                  constexpr table
+//     composite    Z_n has zero divisors, so pivots cannot be normalized.
+//                  The matrix is diagonalized (Smith normal form, U A V = D)
+//                  with unimodular gcd steps and each d_i y_i = (U b)_i is
+//                  solved on its own
+//
+// All paths fill SolveResult as for GF(3): the system has n^nullity
+// solutions when n is prime. For composite n, nullity counts the unknowns
+// whose diagonal entry is 0; zero divisors on the diagonal add more solutions
+// that are not counted. The nullspace basis is GF(3)-only and stays nullptr
+// for every other modulus.
+//================================================================================
+
+namespace modular
+{
+    constexpr uint32_t gcd(uint32_t a, uint32_t b)
+    {
+        while (b)
+        {
+            uint32_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    constexpr bool isPrime(uint32_t n)
+    {
+        if (n < 2)
+            return false;
+        for (uint32_t d = 2; d * d <= n; ++d)
+            if (n % d == 0)
+                return false;
+        return true;
+    }
+
+    //================================================================================
+    // Function: extendedGcd
+    // Description:
+    //     g = gcd(a, b) = s·a + t·b.
+    //================================================================================
+    constexpr int64_t extendedGcd(int64_t a, int64_t b, int64_t &s, int64_t &t)
+    {
+        int64_t s0 = 1, s1 = 0, t0 = 0, t1 = 1;
+        while (b)
+        {
+            int64_t q = a / b;
+            int64_t r = a - q * b;
+            a = b;
+            b = r;
+            int64_t sn = s0 - q * s1, tn = t0 - q * t1;
+            s0 = s1;
+            s1 = sn;
+            t0 = t1;
+            t1 = tn;
+        }
+        s = s0;
+        t = t0;
+        return a;
+    }
+
+    // Inverse of a modulo mod, 0 when a is not a unit
+    constexpr uint32_t inverseMod(uint32_t a, uint32_t mod)
+    {
+        int64_t s = 0, t = 0;
+        if (extendedGcd(a % mod, mod, s, t) != 1)
+            return 0;
+        s %= static_cast<int64_t>(mod);
+        return static_cast<uint32_t>(s < 0 ? s + mod : s);
+    }
+
+    // Moduli up to this size get their inverses as a constexpr table
+    constexpr uint32_t INVERSE_TABLE_LIMIT = 4096;
+
+    template <uint32_t Mod>
+    constexpr std::array<uint32_t, Mod> inverseTable()
+    {
+        std::array<uint32_t, Mod> table{};
+        for (uint32_t a = 1; a < Mod; ++a)
+            table[a] = inverseMod(a, Mod);
+        return table;
+    }
+
+    //================================================================================
+    // Struct: Arithmetic
+    // Description:
+    //     Residue arithmetic modulo Mod on values 0..Mod-1. Mod < 2^16 keeps
+    //     every a + b·c below 2^32, which is the range reduce() handles with a
+    //     single Barrett correction:
+    //         q = ⌊v · ⌊2^32 / Mod⌋ / 2^32⌋ is ⌊v / Mod⌋ or one less
+    //================================================================================
+    template <uint32_t Mod>
+    struct Arithmetic
+    {
+        static_assert(Mod >= 2 && Mod < (1u << 16), "modulus must be in 2..65535");
+
+        static constexpr bool prime = isPrime(Mod);
+        static constexpr uint64_t barrett = (uint64_t(1) << 32) / Mod;
+
+        static constexpr uint32_t reduce(uint64_t v)
+        {
+            uint64_t q = (v * barrett) >> 32;
+            uint32_t r = static_cast<uint32_t>(v - q * Mod);
+            return r >= Mod ? r - Mod : r;
+        }
+
+        // Any int, negative included, to 0..Mod-1
+        static constexpr uint32_t fromInt(int v)
+        {
+            int r = v % static_cast<int>(Mod);
+            return static_cast<uint32_t>(r < 0 ? r + static_cast<int>(Mod) : r);
+        }
+
+        static constexpr uint32_t negate(uint32_t a) { return a ? Mod - a : 0; }
+        static constexpr uint32_t mul(uint32_t a, uint32_t b) { return reduce(uint64_t(a) * b); }
+
+        // a - f·b, the inner operation of every elimination step
+        static constexpr uint32_t mulSub(uint32_t a, uint32_t f, uint32_t b)
+        {
+            return reduce(a + uint64_t(negate(f)) * b);
+        }
+
+        static uint32_t inverse(uint32_t a)
+        {
+            if constexpr (Mod <= INVERSE_TABLE_LIMIT)
+            {
+                static constexpr std::array<uint32_t, Mod> table = inverseTable<Mod>();
+                return table[a];
+            }
+            else
+                return inverseMod(a, Mod);
+        }
+    };
+
+    //================================================================================
+    // Function: finish
+    // Description:
+    //     Common tail of the elimination paths: rank, nullity, the consistency
+    //     check of the rows without pivot and the particular solution.
+    //     value(r, c) reads entry c of reduced row r, column m being the
+    //     right-hand side.
+    //================================================================================
+    template <typename Value>
+    SolveResult finish(size_t n, size_t m, const std::vector<size_t> &pivotCol, Value value)
+    {
+        SolveResult result;
+        result.rank = static_cast<uint32_t>(pivotCol.size());
+        result.nullity = static_cast<uint32_t>(m - pivotCol.size());
+
+        for (size_t r = pivotCol.size(); r < n; ++r)
+            if (value(r, m) != 0)
+                return result;
+
+        result.solution.assign(m, 0);
+        for (size_t r = 0; r < pivotCol.size(); ++r)
+            result.solution[pivotCol[r]] = static_cast<int>(value(r, m));
+        result.solvable = true;
+        return result;
+    }
+
+    //================================================================================
+    // Function: solveGF2
+    // Description:
+    //     Gauss-Jordan over GF(2) on rows packed 64 columns per word, the
+    //     right-hand side as column m. Eliminating a column is one XOR per
+    //     word of every row that has it set, starting at the pivot's word.
+    //================================================================================
+    inline SolveResult solveGF2(const std::vector<std::vector<int>> &matrix, const std::vector<int> &target)
+    {
+        size_t n = matrix.size();
+        size_t m = n ? matrix[0].size() : 0;
+        size_t words = gf3::wordsFor(m + 1);
+
+        std::vector<uint64_t> bits(n * words, 0);
+        for (size_t r = 0; r < n; ++r)
+        {
+            uint64_t *row = &bits[r * words];
+            for (size_t c = 0; c < m; ++c)
+                if (matrix[r][c] & 1)
+                    row[c >> 6] |= uint64_t(1) << (c & 63);
+            if (target[r] & 1)
+                row[m >> 6] |= uint64_t(1) << (m & 63);
+        }
+
+        std::vector<size_t> pivotCol;
+        for (size_t col = 0, row = 0; col < m && row < n; ++col)
+        {
+            size_t word = col >> 6;
+            uint64_t bit = uint64_t(1) << (col & 63);
+
+            size_t pivot = row;
+            while (pivot < n && !(bits[pivot * words + word] & bit))
+                ++pivot;
+            if (pivot == n)
+                continue;
+            if (pivot != row)
+                std::swap_ranges(&bits[pivot * words], &bits[pivot * words] + words, &bits[row * words]);
+
+            const uint64_t *src = &bits[row * words];
+            for (size_t i = 0; i < n; ++i)
+            {
+                uint64_t *dst = &bits[i * words];
+                if (i != row && (dst[word] & bit))
+                    for (size_t w = word; w < words; ++w)
+                        dst[w] ^= src[w];
+            }
+            pivotCol.push_back(col);
+            ++row;
+        }
+
+        return finish(n, m, pivotCol, [&](size_t r, size_t c) {
+            return (bits[r * words + (c >> 6)] >> (c & 63)) & 1;
+        });
+    }
+
+    //================================================================================
+    // Function: solvePrime
+    // Description:
+    //     Gauss-Jordan over GF(Mod) on flat rows of residues. The pivot row is
+    //     scaled by its tabled inverse, every other row gets one mulSub per
+    //     entry.
+    //================================================================================
+    template <uint32_t Mod>
+    SolveResult solvePrime(const std::vector<std::vector<int>> &matrix, const std::vector<int> &target)
+    {
+        using F = Arithmetic<Mod>;
+
+        size_t n = matrix.size();
+        size_t m = n ? matrix[0].size() : 0;
+        size_t stride = m + 1;
+
+        std::vector<uint32_t> a(n * stride);
+        for (size_t r = 0; r < n; ++r)
+        {
+            for (size_t c = 0; c < m; ++c)
+                a[r * stride + c] = F::fromInt(matrix[r][c]);
+            a[r * stride + m] = F::fromInt(target[r]);
+        }
+
+        std::vector<size_t> pivotCol;
+        for (size_t col = 0, row = 0; col < m && row < n; ++col)
+        {
+            size_t pivot = row;
+            while (pivot < n && a[pivot * stride + col] == 0)
+                ++pivot;
+            if (pivot == n)
+                continue;
+            if (pivot != row)
+                std::swap_ranges(&a[pivot * stride], &a[pivot * stride] + stride, &a[row * stride]);
+
+            uint32_t *src = &a[row * stride];
+            uint32_t inv = F::inverse(src[col]);
+            for (size_t j = col; j < stride; ++j)
+                src[j] = F::mul(src[j], inv);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                uint32_t *dst = &a[i * stride];
+                uint32_t factor = dst[col];
+                if (i == row || factor == 0)
+                    continue;
+                for (size_t j = col; j < stride; ++j)
+                    dst[j] = F::mulSub(dst[j], factor, src[j]);
+            }
+            pivotCol.push_back(col);
+            ++row;
+        }
+
+        return finish(n, m, pivotCol, [&](size_t r, size_t c) { return a[r * stride + c]; });
+    }
+
+    //================================================================================
+    // Class: SmithSolver
+    // Description:
+    //     Diagonalizes A over Z_Mod with unimodular row and column operations,
+    //     U A V = D. Row operations are applied to the right-hand side as they
+    //     happen (it becomes U b), column operations to V. A pivot p and an
+    //     entry e below (or beside) it are combined with the Bezout
+    //     coefficients of g = gcd(p, e) = s·p + t·e:
+    //
+    //         [  s     t  ] [p]   [g]
+    //         [ -e/g  p/g ] [e] = [0]      determinant 1
+    //
+    //     Each non-trivial step replaces p by a proper divisor, so clearing
+    //     row and column of a pivot alternately terminates. Then
+    //     d_i y_i = (U b)_i is solvable iff gcd(d_i, Mod) divides (U b)_i,
+    //     and x = V y.
+    //================================================================================
+    template <uint32_t Mod>
+    class SmithSolver
+    {
+    private:
+        using F = Arithmetic<Mod>;
+
+        size_t n, m;
+        std::vector<uint32_t> a; // n × m, row-major
+        std::vector<uint32_t> rhs;
+        std::vector<uint32_t> v; // m × m, row-major
+
+        // Bezout step mixing lines p and e: returns {s, t, -e/g, p/g} mod Mod.
+        // When p divides e the pivot line is kept as is (s = 1, t = 0), so a
+        // step either shrinks the pivot or leaves the pivot line untouched.
+        static std::array<uint32_t, 4> bezout(uint32_t p, uint32_t e)
+        {
+            int64_t s = 1, t = 0, g = p;
+            if (e % p != 0)
+                g = extendedGcd(p, e, s, t);
+            auto mod = [](int64_t x) {
+                x %= static_cast<int64_t>(Mod);
+                return static_cast<uint32_t>(x < 0 ? x + Mod : x);
+            };
+            return {mod(s), mod(t), mod(-static_cast<int64_t>(e) / g), mod(static_cast<int64_t>(p) / g)};
+        }
+
+        static void combine(uint32_t &x, uint32_t &y, const std::array<uint32_t, 4> &k)
+        {
+            uint32_t nx = F::reduce(F::mul(k[0], x) + uint64_t(k[1]) * y);
+            uint32_t ny = F::reduce(F::mul(k[2], x) + uint64_t(k[3]) * y);
+            x = nx;
+            y = ny;
+        }
+
+        // Rows t and i, clears a[i][t]
+        void combineRows(size_t t, size_t i)
+        {
+            auto k = bezout(a[t * m + t], a[i * m + t]);
+            for (size_t c = t; c < m; ++c)
+                combine(a[t * m + c], a[i * m + c], k);
+            combine(rhs[t], rhs[i], k);
+        }
+
+        // Columns t and j, clears a[t][j]
+        void combineColumns(size_t t, size_t j)
+        {
+            auto k = bezout(a[t * m + t], a[t * m + j]);
+            for (size_t r = t; r < n; ++r)
+                combine(a[r * m + t], a[r * m + j], k);
+            for (size_t r = 0; r < m; ++r)
+                combine(v[r * m + t], v[r * m + j], k);
+        }
+
+        void swapRows(size_t r0, size_t r1)
+        {
+            std::swap_ranges(&a[r0 * m], &a[r0 * m] + m, &a[r1 * m]);
+            std::swap(rhs[r0], rhs[r1]);
+        }
+
+        void swapColumns(size_t c0, size_t c1)
+        {
+            for (size_t r = 0; r < n; ++r)
+                std::swap(a[r * m + c0], a[r * m + c1]);
+            for (size_t r = 0; r < m; ++r)
+                std::swap(v[r * m + c0], v[r * m + c1]);
+        }
+
+    public:
+        SmithSolver(const std::vector<std::vector<int>> &matrix, const std::vector<int> &target)
+            : n(matrix.size()), m(matrix.empty() ? 0 : matrix[0].size()), a(n * m), rhs(n), v(m * m, 0)
+        {
+            for (size_t r = 0; r < n; ++r)
+            {
+                for (size_t c = 0; c < m; ++c)
+                    a[r * m + c] = F::fromInt(matrix[r][c]);
+                rhs[r] = F::fromInt(target[r]);
+            }
+            for (size_t c = 0; c < m; ++c)
+                v[c * m + c] = 1;
+        }
+
+        SolveResult solve()
+        {
+            size_t rank = 0;
+            for (size_t t = 0; t < n && t < m; ++t, ++rank)
+            {
+                // Pivot with the smallest gcd with Mod (a unit if there is one)
+                size_t pr = n, pc = m;
+                uint32_t best = Mod;
+                for (size_t r = t; r < n && best > 1; ++r)
+                    for (size_t c = t; c < m; ++c)
+                    {
+                        uint32_t value = a[r * m + c];
+                        uint32_t g = value ? gcd(value, Mod) : Mod;
+                        if (g < best)
+                        {
+                            best = g;
+                            pr = r;
+                            pc = c;
+                            if (g == 1)
+                                break;
+                        }
+                    }
+                if (pr == n)
+                    break;
+                if (pr != t)
+                    swapRows(t, pr);
+                if (pc != t)
+                    swapColumns(t, pc);
+
+                for (bool clean = false; !clean;)
+                {
+                    for (size_t i = t + 1; i < n; ++i)
+                        if (a[i * m + t])
+                            combineRows(t, i);
+                    clean = true;
+                    for (size_t j = t + 1; j < m; ++j)
+                        if (a[t * m + j])
+                        {
+                            combineColumns(t, j);
+                            clean = false;
+                        }
+                    if (!clean)
+                    {
+                        clean = true;
+                        for (size_t i = t + 1; i < n && clean; ++i)
+                            clean = a[i * m + t] == 0;
+                    }
+                }
+            }
+
+            SolveResult result;
+            result.rank = static_cast<uint32_t>(rank);
+            result.nullity = static_cast<uint32_t>(m - rank);
+
+            for (size_t r = rank; r < n; ++r)
+                if (rhs[r] != 0)
+                    return result;
+
+            // d y = c (mod Mod) ⇔ (d/g) y = c/g (mod Mod/g), g = gcd(d, Mod)
+            std::vector<uint32_t> y(m, 0);
+            for (size_t i = 0; i < rank; ++i)
+            {
+                uint32_t d = a[i * m + i];
+                uint32_t g = gcd(d, Mod);
+                if (rhs[i] % g != 0)
+                    return result;
+                uint32_t reduced = Mod / g;
+                y[i] = static_cast<uint32_t>(uint64_t(rhs[i] / g) * inverseMod(d / g, reduced) % reduced);
+            }
+
+            result.solution.assign(m, 0);
+            for (size_t c = 0; c < m; ++c)
+            {
+                uint64_t sum = 0;
+                for (size_t i = 0; i < rank; ++i)
+                    sum = F::reduce(sum + uint64_t(v[c * m + i]) * y[i]);
+                result.solution[c] = static_cast<int>(sum);
+            }
+            result.solvable = true;
+            return result;
+        }
+    };
+}
+
+//================================================================================
+// Function: solveModular
+// Description:
+//     Solves matrix · x = target over Z_Mod with the kernel chosen for Mod at
+//     compile time (see above). Entries and targets may be any int, they are
+//     reduced first; the solution has values 0..Mod-1, free unknowns 0.
+//================================================================================
+template <uint32_t Mod>
+SolveResult solveModular(const std::vector<std::vector<int>> &matrix, const std::vector<int> &target)
+{
+    using F = modular::Arithmetic<Mod>;
+
+    if constexpr (Mod == 2)
+        return modular::solveGF2(matrix, target);
+    else if constexpr (Mod == 3)
+    {
+        size_t n = matrix.size();
+        size_t m = n ? matrix[0].size() : 0;
+        PackedGF3Matrix packed(n, m);
+        std::vector<int> reduced(n);
+        for (size_t r = 0; r < n; ++r)
+        {
+            for (size_t c = 0; c < m; ++c)
+                if (uint32_t value = F::fromInt(matrix[r][c]))
+                    packed.set(r, c, static_cast<int>(value));
+            reduced[r] = static_cast<int>(F::fromInt(target[r]));
+        }
+        return solvePackedLinearSystem(packed, reduced);
+    }
+    else if constexpr (F::prime)
+        return modular::solvePrime<Mod>(matrix, target);
+    else
+        return modular::SmithSolver<Mod>(matrix, target).solve();
+}
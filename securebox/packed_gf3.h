@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//================================================================================
+// Bitsliced GF(3) arithmetic
+//================================================================================
+// A vector of trits is stored as two bit planes of 64-bit words:
+//     ones → bit set where the value is 1
+//     twos → bit set where the value is 2
+// A word pair therefore carries 64 coefficients and the field operations
+// below handle all of them with a handful of bitwise instructions.
+//================================================================================
+
+namespace gf3
+{
+    //================================================================================
+    // Function: add
+    // Description:
+    //     (a1, a2) + (b1, b2) for 64 lanes at once.
+    //================================================================================
+    inline void add(uint64_t a1, uint64_t a2, uint64_t b1, uint64_t b2, uint64_t &r1, uint64_t &r2)
+    {
+        uint64_t t = (a1 | b2) ^ (a2 | b1);
+        r1 = (a2 | b2) ^ t;
+        r2 = (a1 | b1) ^ t;
+    }
+
+    //================================================================================
+    // Function: sub
+    // Description:
+    //     (a1, a2) - (b1, b2) for 64 lanes at once. Negation swaps the planes,
+    //     so this is add() with b1 and b2 exchanged.
+    //================================================================================
+    inline void sub(uint64_t a1, uint64_t a2, uint64_t b1, uint64_t b2, uint64_t &r1, uint64_t &r2)
+    {
+        uint64_t t = (a1 | b1) ^ (a2 | b2);
+        r1 = (a2 | b1) ^ t;
+        r2 = (a1 | b2) ^ t;
+    }
+
+    inline int countTrailingZeros(uint64_t v)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, v);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(v);
+#endif
+    }
+
+    inline int popCount(uint64_t v)
+    {
+#if defined(_MSC_VER)
+        return static_cast<int>(__popcnt64(v));
+#else
+        return __builtin_popcountll(v);
+#endif
+    }
+
+    inline size_t wordsFor(size_t count)
+    {
+        return (count + 63) / 64;
+    }
+}
+
+//================================================================================
+// Class: PackedGF3Matrix
+// Description:
+//     Dense GF(3) matrix with bitsliced rows. Each row occupies 2 * words()
+//     consecutive words: the ones plane followed by the twos plane. This is
+//     16× smaller than std::vector<std::vector<int>> and keeps a whole row in
+//     one contiguous block for the row operations used by elimination.
+//================================================================================
+class PackedGF3Matrix
+{
+private:
+    size_t rowCount, colCount, wordCount;
+    std::vector<uint64_t> data;
+
+public:
+    PackedGF3Matrix() : rowCount(0), colCount(0), wordCount(0) {}
+
+    PackedGF3Matrix(size_t rows, size_t cols)
+        : rowCount(rows), colCount(cols), wordCount(gf3::wordsFor(cols)),
+          data(rows * 2 * gf3::wordsFor(cols), 0)
+    {
+    }
+
+    //================================================================================
+    // Method: fromDense
+    // Description:
+    //     Packs a std::vector<std::vector<int>> matrix with values in 0..2.
+    //================================================================================
+    static PackedGF3Matrix fromDense(const std::vector<std::vector<int>> &matrix)
+    {
+        size_t rows = matrix.size();
+        size_t cols = rows ? matrix[0].size() : 0;
+        PackedGF3Matrix packed(rows, cols);
+        for (size_t r = 0; r < rows; ++r)
+            for (size_t c = 0; c < cols; ++c)
+                packed.set(r, c, matrix[r][c]);
+        return packed;
+    }
+
+    size_t rows() const { return rowCount; }
+    size_t cols() const { return colCount; }
+    size_t words() const { return wordCount; }
+
+    uint64_t *ones(size_t row) { return &data[row * 2 * wordCount]; }
+    uint64_t *twos(size_t row) { return &data[row * 2 * wordCount + wordCount]; }
+    const uint64_t *ones(size_t row) const { return &data[row * 2 * wordCount]; }
+    const uint64_t *twos(size_t row) const { return &data[row * 2 * wordCount + wordCount]; }
+
+    int get(size_t row, size_t col) const
+    {
+        uint64_t bit = uint64_t(1) << (col & 63);
+        if (ones(row)[col >> 6] & bit)
+            return 1;
+        if (twos(row)[col >> 6] & bit)
+            return 2;
+        return 0;
+    }
+
+    void set(size_t row, size_t col, int value)
+    {
+        uint64_t bit = uint64_t(1) << (col & 63);
+        uint64_t &one = ones(row)[col >> 6];
+        uint64_t &two = twos(row)[col >> 6];
+        one &= ~bit;
+        two &= ~bit;
+        if (value == 1)
+            one |= bit;
+        else if (value == 2)
+            two |= bit;
+    }
+
+    //================================================================================
+    // Method: addRow / subRow
+    // Description:
+    //     row[dst] ±= row[src], starting at word firstWord (earlier words are
+    //     known to be zero in src and are skipped).
+    //================================================================================
+    void addRow(size_t dst, size_t src, size_t firstWord = 0)
+    {
+        uint64_t *d1 = ones(dst), *d2 = twos(dst);
+        const uint64_t *s1 = ones(src), *s2 = twos(src);
+        for (size_t w = firstWord; w < wordCount; ++w)
+            gf3::add(d1[w], d2[w], s1[w], s2[w], d1[w], d2[w]);
+    }
+
+    void subRow(size_t dst, size_t src, size_t firstWord = 0)
+    {
+        uint64_t *d1 = ones(dst), *d2 = twos(dst);
+        const uint64_t *s1 = ones(src), *s2 = twos(src);
+        for (size_t w = firstWord; w < wordCount; ++w)
+            gf3::sub(d1[w], d2[w], s1[w], s2[w], d1[w], d2[w]);
+    }
+
+    //================================================================================
+    // Method: negateRow
+    // Description:
+    //     Multiplies a row by 2 (= -1), which only swaps the two planes.
+    //================================================================================
+    void negateRow(size_t row)
+    {
+        uint64_t *r1 = ones(row), *r2 = twos(row);
+        for (size_t w = 0; w < wordCount; ++w)
+            std::swap(r1[w], r2[w]);
+    }
+
+    void swapRows(size_t a, size_t b)
+    {
+        if (a == b)
+            return;
+        uint64_t *ra = ones(a), *rb = ones(b);
+        for (size_t w = 0; w < 2 * wordCount; ++w)
+            std::swap(ra[w], rb[w]);
+    }
+
+    //================================================================================
+    // Method: leadingColumn
+    // Description:
+    //     Returns the first column >= fromCol with a nonzero coefficient in the
+    //     row, or cols() when there is none. Uses count-trailing-zeros on the
+    //     OR of both planes.
+    //================================================================================
+    size_t leadingColumn(size_t row, size_t fromCol = 0) const
+    {
+        const uint64_t *r1 = ones(row), *r2 = twos(row);
+        size_t w = fromCol >> 6;
+        if (w >= wordCount)
+            return colCount;
+        uint64_t word = (r1[w] | r2[w]) & (~uint64_t(0) << (fromCol & 63));
+        while (true)
+        {
+            if (word)
+            {
+                size_t col = w * 64 + gf3::countTrailingZeros(word);
+                return col < colCount ? col : colCount;
+            }
+            if (++w >= wordCount)
+                return colCount;
+            word = r1[w] | r2[w];
+        }
+    }
+};
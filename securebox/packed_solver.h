@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "packed_gf3.h"
+#include "solve_result.h"
+
+//================================================================================
+// Function: buildPackedEffectMatrix
+// Description:
+//     Builds the toggle effect matrix directly in bitsliced form, without
+//     going through the dense std::vector<std::vector<int>> representation.
+//     Column (y * width + x) holds the cells changed by toggle(x, y).
+//================================================================================
+inline PackedGF3Matrix buildPackedEffectMatrix(uint32_t width, uint32_t height)
+{
+    size_t totalCells = static_cast<size_t>(width) * height;
+    PackedGF3Matrix matrix(totalCells, totalCells);
+
+    // Cell (cx, cy) is hit by every toggle in row cy and column cx, once each
+    for (uint32_t cy = 0; cy < height; ++cy)
+    {
+        for (uint32_t cx = 0; cx < width; ++cx)
+        {
+            size_t cellIndex = static_cast<size_t>(cy) * width + cx;
+            for (uint32_t x = 0; x < width; ++x)
+                matrix.set(cellIndex, static_cast<size_t>(cy) * width + x, 1);
+            for (uint32_t y = 0; y < height; ++y)
+                matrix.set(cellIndex, static_cast<size_t>(y) * width + cx, 1);
+        }
+    }
+
+    return matrix;
+}
+
+//================================================================================
+// Function: eliminatePacked
+// Description:
+//     Gauss-Jordan elimination of a bitsliced matrix in place. Rows are
+//     processed in order; the pivot of each row is its first nonzero column
+//     (found with count-trailing-zeros), which is then cleared from every
+//     other row with one bitsliced row add/subtract.
+//     Only the first pivotCols columns may be chosen as pivots, the rest are
+//     carried along (augmented right-hand sides).
+//     Returns the pivot column of every row, or cols() for rows without one.
+//================================================================================
+inline std::vector<size_t> eliminatePacked(PackedGF3Matrix &matrix, size_t pivotCols)
+{
+    size_t n = matrix.rows();
+    std::vector<size_t> pivotOf(n, matrix.cols());
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t col = matrix.leadingColumn(i);
+        if (col >= pivotCols)
+            continue;
+
+        pivotOf[i] = col;
+        if (matrix.get(i, col) == 2)
+            matrix.negateRow(i);
+
+        size_t word = col >> 6;
+        uint64_t bit = uint64_t(1) << (col & 63);
+        for (size_t j = 0; j < n; ++j)
+        {
+            if (j == i)
+                continue;
+            if (matrix.ones(j)[word] & bit)
+                matrix.subRow(j, i, word);
+            else if (matrix.twos(j)[word] & bit)
+                matrix.addRow(j, i, word);
+        }
+    }
+
+    return pivotOf;
+}
+
+namespace packed_detail
+{
+    //================================================================================
+    // Function: augment
+    // Description:
+    //     Copy of matrix with target appended as column cols().
+    //================================================================================
+    inline PackedGF3Matrix augment(const PackedGF3Matrix &matrix, const std::vector<int> &target)
+    {
+        size_t n = matrix.rows();
+        size_t m = matrix.cols();
+
+        PackedGF3Matrix augmented(n, m + 1);
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::copy(matrix.ones(i), matrix.ones(i) + matrix.words(), augmented.ones(i));
+            std::copy(matrix.twos(i), matrix.twos(i) + matrix.words(), augmented.twos(i));
+            augmented.set(i, m, target[i]);
+        }
+        return augmented;
+    }
+
+    //================================================================================
+    // Function: nullspace
+    // Description:
+    //     Kernel basis of an eliminated (reduced row echelon) matrix with m
+    //     unknowns: one vector per free column f, with 1 at f and
+    //     -rref[i][f] at the pivot column of every pivot row i.
+    //================================================================================
+    inline std::shared_ptr<const PackedGF3Matrix> nullspace(const PackedGF3Matrix &rref,
+                                                            const std::vector<size_t> &pivotOf, size_t m)
+    {
+        std::vector<bool> isPivot(m, false);
+        for (size_t i = 0; i < rref.rows(); ++i)
+            if (pivotOf[i] < m)
+                isPivot[pivotOf[i]] = true;
+
+        std::vector<size_t> freeColumns;
+        for (size_t c = 0; c < m; ++c)
+            if (!isPivot[c])
+                freeColumns.push_back(c);
+
+        auto basis = std::make_shared<PackedGF3Matrix>(freeColumns.size(), m);
+        for (size_t k = 0; k < freeColumns.size(); ++k)
+            basis->set(k, freeColumns[k], 1);
+        for (size_t i = 0; i < rref.rows(); ++i)
+        {
+            if (pivotOf[i] >= m)
+                continue;
+            for (size_t k = 0; k < freeColumns.size(); ++k)
+                if (int value = rref.get(i, freeColumns[k]))
+                    basis->set(k, pivotOf[i], 3 - value);
+        }
+        return basis;
+    }
+
+    //================================================================================
+    // Function: readSolution
+    // Description:
+    //     Reads the solution of an eliminated augmented system with m unknowns.
+    //     Rank and nullspace are filled in whether or not the target is in the
+    //     range.
+    //================================================================================
+    inline SolveResult readSolution(const PackedGF3Matrix &augmented, const std::vector<size_t> &pivotOf, size_t m)
+    {
+        SolveResult result;
+        result.solvable = true;
+        for (size_t i = 0; i < augmented.rows(); ++i)
+        {
+            if (pivotOf[i] < m)
+                ++result.rank;
+            else if (augmented.get(i, m) != 0)
+                result.solvable = false; // 0 = nonzero: the target is outside the range of the matrix
+        }
+        result.nullity = static_cast<uint32_t>(m - result.rank);
+        result.nullspace = nullspace(augmented, pivotOf, m);
+
+        if (!result.solvable)
+            return result;
+
+        result.solution.assign(m, 0);
+        for (size_t i = 0; i < augmented.rows(); ++i)
+            if (pivotOf[i] < m)
+                result.solution[pivotOf[i]] = augmented.get(i, m);
+        return result;
+    }
+
+    //================================================================================
+    // Function: augmentBatch
+    // Description:
+    //     Copy of matrix with the targets appended as columns, starting on the
+    //     first word boundary after cols(): word w of the right-hand side part
+    //     holds boxes 64·w .. 64·w + 63, one per bit lane.
+    //================================================================================
+    inline PackedGF3Matrix augmentBatch(const PackedGF3Matrix &matrix, const std::vector<std::vector<int>> &targets)
+    {
+        size_t n = matrix.rows();
+        size_t first = matrix.words() * 64;
+
+        PackedGF3Matrix augmented(n, first + targets.size());
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::copy(matrix.ones(i), matrix.ones(i) + matrix.words(), augmented.ones(i));
+            std::copy(matrix.twos(i), matrix.twos(i) + matrix.words(), augmented.twos(i));
+        }
+        for (size_t box = 0; box < targets.size(); ++box)
+            for (size_t i = 0; i < n; ++i)
+                augmented.set(i, first + box, ((targets[box][i] % 3) + 3) % 3);
+        return augmented;
+    }
+
+    //================================================================================
+    // Function: readBatch
+    // Description:
+    //     readSolution for every right-hand side of an eliminated augmentBatch
+    //     matrix. A box is unsolvable when any row without pivot is nonzero in
+    //     its lane, which is collected for 64 boxes per word.
+    //================================================================================
+    inline std::vector<SolveResult> readBatch(const PackedGF3Matrix &augmented, const std::vector<size_t> &pivotOf,
+                                              size_t m, size_t boxes)
+    {
+        size_t firstWord = gf3::wordsFor(m);
+        size_t first = firstWord * 64;
+
+        std::vector<uint64_t> inconsistent(gf3::wordsFor(boxes), 0);
+        size_t rank = 0;
+        for (size_t i = 0; i < augmented.rows(); ++i)
+        {
+            if (pivotOf[i] < m)
+            {
+                ++rank;
+                continue;
+            }
+            for (size_t w = 0; w < inconsistent.size(); ++w)
+                inconsistent[w] |= augmented.ones(i)[firstWord + w] | augmented.twos(i)[firstWord + w];
+        }
+
+        std::shared_ptr<const PackedGF3Matrix> kernel = nullspace(augmented, pivotOf, m);
+        std::vector<SolveResult> results(boxes);
+        for (size_t box = 0; box < boxes; ++box)
+        {
+            results[box].rank = static_cast<uint32_t>(rank);
+            results[box].nullity = static_cast<uint32_t>(m - rank);
+            results[box].nullspace = kernel;
+            if ((inconsistent[box >> 6] >> (box & 63)) & 1)
+                continue;
+            results[box].solvable = true;
+            results[box].solution.assign(m, 0);
+        }
+
+        for (size_t i = 0; i < augmented.rows(); ++i)
+        {
+            if (pivotOf[i] >= m)
+                continue;
+            for (size_t box = 0; box < boxes; ++box)
+                if (results[box].solvable)
+                    results[box].solution[pivotOf[i]] = augmented.get(i, first + box);
+        }
+        return results;
+    }
+}
+
+//================================================================================
+// Function: solvePackedLinearSystem
+// Description:
+//     Bitsliced counterpart of solveModular<3> for general toggle operators.
+//     Every row operation handles 64 coefficients per word pair, so the
+//     elimination costs O(n²·m / 64) word operations.
+//================================================================================
+inline SolveResult solvePackedLinearSystem(const PackedGF3Matrix &matrix, const std::vector<int> &target)
+{
+    PackedGF3Matrix augmented = packed_detail::augment(matrix, target);
+    std::vector<size_t> pivotOf = eliminatePacked(augmented, matrix.cols());
+    return packed_detail::readSolution(augmented, pivotOf, matrix.cols());
+}
+
+//================================================================================
+// Function: solveBatch
+// Description:
+//     Solves matrix · x = target for many targets of the same matrix in one
+//     elimination. The targets ride along as extra columns, 64 of them per
+//     word pair, so a row operation updates 64 boxes at once and the cost of
+//     k boxes is one elimination over m + k columns instead of k eliminations.
+//================================================================================
+inline std::vector<SolveResult> solveBatch(const PackedGF3Matrix &matrix, const std::vector<std::vector<int>> &targets)
+{
+    PackedGF3Matrix augmented = packed_detail::augmentBatch(matrix, targets);
+    std::vector<size_t> pivotOf = eliminatePacked(augmented, matrix.cols());
+    return packed_detail::readBatch(augmented, pivotOf, matrix.cols(), targets.size());
+}
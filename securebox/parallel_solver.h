@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packed_solver.h"
+#include "worker_pool.h"
+
+//================================================================================
+// Parallel elimination
+//================================================================================
+// In eliminatePacked every pivot step updates all other rows independently,
+// so those updates are split into contiguous row slices, one per worker.
+//
+// Synchronizing once per pivot costs a wake-up and a barrier per column. The
+// blocked variant first reduces a panel of k consecutive rows against each
+// other on the calling thread (plain Gauss-Jordan inside the panel), then lets
+// the workers apply all pivots of the panel to their rows in one go: one
+// barrier per k pivots. Inside a reduced panel every pivot column is zero in
+// the other panel rows, so the order in which a row applies them does not
+// matter and the result is the same as eliminatePacked's.
+//================================================================================
+
+//================================================================================
+// Function: eliminatePackedParallel
+// Description:
+//     eliminatePacked with the row updates spread over pool. panel = 1 is the
+//     barrier-per-pivot scheme, larger panels trade a serial panel reduction
+//     (k² row operations) for k times fewer barriers.
+//================================================================================
+inline std::vector<size_t> eliminatePackedParallel(PackedGF3Matrix &matrix, size_t pivotCols, WorkerPool &pool,
+                                                   size_t panel = 32)
+{
+    size_t n = matrix.rows();
+    std::vector<size_t> pivotOf(n, matrix.cols());
+    std::vector<size_t> panelRows;
+    panel = std::max<size_t>(panel, 1);
+
+    // Clears the pivot column of row src from row dst
+    auto eliminate = [&](size_t dst, size_t src) {
+        size_t col = pivotOf[src];
+        size_t word = col >> 6;
+        uint64_t bit = uint64_t(1) << (col & 63);
+        if (matrix.ones(dst)[word] & bit)
+            matrix.subRow(dst, src, word);
+        else if (matrix.twos(dst)[word] & bit)
+            matrix.addRow(dst, src, word);
+    };
+
+    for (size_t start = 0; start < n; start += panel)
+    {
+        size_t end = std::min(n, start + panel);
+
+        // Panel reduction on the calling thread
+        panelRows.clear();
+        for (size_t i = start; i < end; ++i)
+        {
+            size_t col = matrix.leadingColumn(i);
+            if (col >= pivotCols)
+                continue;
+
+            pivotOf[i] = col;
+            if (matrix.get(i, col) == 2)
+                matrix.negateRow(i);
+
+            for (size_t j = start; j < end; ++j)
+                if (j != i)
+                    eliminate(j, i);
+            panelRows.push_back(i);
+        }
+
+        if (panelRows.empty())
+            continue;
+
+        // Every other row applies the panel's pivots, one slice per worker
+        pool.run([&](unsigned worker) {
+            auto slice = pool.range(n, worker);
+            for (size_t j = slice.first; j < slice.second; ++j)
+            {
+                if (j >= start && j < end)
+                    continue;
+                for (size_t i : panelRows)
+                    eliminate(j, i);
+            }
+        });
+    }
+
+    return pivotOf;
+}
+
+//================================================================================
+// Function: solvePackedLinearSystemParallel
+// Description:
+//     solvePackedLinearSystem on top of eliminatePackedParallel. The second
+//     overload creates a pool of threads workers (0 = one per hardware
+//     thread) for a single solve.
+//================================================================================
+inline SolveResult solvePackedLinearSystemParallel(const PackedGF3Matrix &matrix, const std::vector<int> &target,
+                                                   WorkerPool &pool, size_t panel = 32)
+{
+    PackedGF3Matrix augmented = packed_detail::augment(matrix, target);
+    std::vector<size_t> pivotOf = eliminatePackedParallel(augmented, matrix.cols(), pool, panel);
+    return packed_detail::readSolution(augmented, pivotOf, matrix.cols());
+}
+
+inline SolveResult solvePackedLinearSystemParallel(const PackedGF3Matrix &matrix, const std::vector<int> &target,
+                                                   unsigned threads = 0, size_t panel = 32)
+{
+    WorkerPool pool(threads);
+    return solvePackedLinearSystemParallel(matrix, target, pool, panel);
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <time.h>
+#include <utility>
+#include <vector>
+
+#include "box_storage.h"
+
+//================================================================================
+// Struct: Move
+// Description:
+//     toggle(x, y) applied count times.
+//================================================================================
+struct Move
+{
+    int x, y, count;
+};
+
+//================================================================================
+// Class: SecureBox
+// Description:
+//     Represents a 2D grid of integer states:
+//         0 = fully unlocked
+//         1 = partially locked
+//         2 = fully locked
+//     The grid itself lives in a storage policy (see box_storage.h), so the
+//     memory layout can be picked per workload and grid size.
+//================================================================================
+template <typename Storage = FlatStorage>
+class SecureBox
+{
+private:
+    Storage box;
+    std::mt19937_64 rng;
+    uint32_t xSize, ySize;
+
+public:
+
+    //================================================================================
+    // Constructor: SecureBox
+    // Description:
+    //     Initializes the box with dimensions x × y and randomizes the grid
+    //     using pseudo-random toggle operations. Storages that need settings
+    //     (e.g. the file of a MappedStorage) are passed in ready-made. A lazy
+    //     storage is flushed after the shuffle, so the box starts with O(1)
+    //     isLocked() and histogram().
+    //================================================================================
+    SecureBox(uint32_t x, uint32_t y, Storage storage = Storage()) : box(std::move(storage)), xSize(x), ySize(y)
+    {
+        rng.seed(time(0));
+        box.resize(x, y);
+        shuffle();
+        box.flush();
+    }
+
+    //================================================================================
+    // Method: toggle
+    // Description:
+    //     Applies modulo-3 increment to:
+    //         - all cells in column x (↑↓)
+    //         - all cells in row y (←→)
+    //         - compensates the (x, y) cell by incrementing it again (+2 mod 3)
+    //================================================================================
+    void toggle(uint32_t x, uint32_t y)
+    {
+        // Vertical (column)
+        box.incrementColumn(x);
+
+        // Horizontal (row)
+        box.incrementRow(y);
+
+        // Center cell was incremented twice, fix it to be +1 total
+        box.increment(x, y, 2);
+    }
+
+    //================================================================================
+    // Method: applyMoves
+    // Description:
+    //     Applies a whole list of moves in one pass. Every move adds its count
+    //     to a per-row and a per-column total (mod 3), each cell is then
+    //     updated exactly once with its row and column total, and the centers
+    //     are corrected per move. O(W·H + moves) instead of O(moves·(W+H)).
+    //================================================================================
+    void applyMoves(const Move *moves, size_t count)
+    {
+        std::vector<uint8_t> rowTotal(ySize, 0), colTotal(xSize, 0);
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint8_t times = static_cast<uint8_t>(((moves[i].count % 3) + 3) % 3);
+            rowTotal[moves[i].y] = (rowTotal[moves[i].y] + times) % 3;
+            colTotal[moves[i].x] = (colTotal[moves[i].x] + times) % 3;
+        }
+
+        box.addOffsets(rowTotal.data(), colTotal.data());
+
+        // Row and column both covered the center, it should only get +count
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint8_t times = static_cast<uint8_t>(((moves[i].count % 3) + 3) % 3);
+            if (times)
+                box.increment(moves[i].x, moves[i].y, 3 - times);
+        }
+    }
+
+    void applyMoves(const std::vector<Move> &moves)
+    {
+        applyMoves(moves.data(), moves.size());
+    }
+
+    //================================================================================
+    // Method: applyLineSolution
+    // Description:
+    //     Applies the toggle vector t[y][x] = rowTotal[y] + colTotal[x] + s[y][x]
+    //     of a closed-form line solution (s = current state, i.e. -target)
+    //     without ever storing t or a move list. rowSum and colSum are the
+    //     line sums of s. Row y of t sums to
+    //
+    //         rowT[y] = W·rowTotal[y] + ΣcolTotal + rowSum[y]
+    //
+    //     and column x to colT[x] = H·colTotal[x] + ΣrowTotal + colSum[x].
+    //     Every toggle adds t to its row and column and -t to its center, so
+    //     each cell ends at s + rowT[y] + colT[x] - t, which is
+    //
+    //         (rowT[y] - rowTotal[y]) + (colT[x] - colTotal[x])
+    //
+    //     no matter what s was. The box is reset and those offsets added in one
+    //     addOffsets() pass, O(W + H) work on top of it. That is the state t
+    //     really leads to, so a wrong line solution leaves the box locked.
+    //================================================================================
+    void applyLineSolution(const std::vector<int> &rowTotal, const std::vector<int> &colTotal,
+                           const std::vector<int> &rowSum, const std::vector<int> &colSum)
+    {
+        unsigned rowTotalSum = 0, colTotalSum = 0;
+        for (uint32_t y = 0; y < ySize; ++y)
+            rowTotalSum += rowTotal[y];
+        for (uint32_t x = 0; x < xSize; ++x)
+            colTotalSum += colTotal[x];
+
+        // rowT - rowTotal and colT - colTotal, with +2·rowTotal for -rowTotal (mod 3)
+        std::vector<uint8_t> rowOffset(ySize), colOffset(xSize);
+        for (uint32_t y = 0; y < ySize; ++y)
+            rowOffset[y] = static_cast<uint8_t>(((xSize % 3) * rowTotal[y] + colTotalSum + rowSum[y] + 2 * rowTotal[y]) % 3);
+        for (uint32_t x = 0; x < xSize; ++x)
+            colOffset[x] = static_cast<uint8_t>(((ySize % 3) * colTotal[x] + rowTotalSum + colSum[x] + 2 * colTotal[x]) % 3);
+
+        box.resize(xSize, ySize);
+        box.addOffsets(rowOffset.data(), colOffset.data());
+        box.flush();
+    }
+
+    //================================================================================
+    // Method: isLocked
+    // Description:
+    //     Returns true if any cell is not 0 (i.e. locked or partially locked).
+    //     Returns false only if all cells are fully unlocked (0).
+    //     The storage keeps a running histogram, so this is a single load.
+    //================================================================================
+    bool isLocked() const
+    {
+        return box.anyNonZero();
+    }
+
+    //================================================================================
+    // Method: lockedCount / histogram
+    // Description:
+    //     Number of cells that are not 0, and the number of cells per value
+    //     (index 0, 1, 2). Meant for progress reporting on large boxes.
+    //================================================================================
+    uint64_t lockedCount() const
+    {
+        auto counts = box.histogram();
+        return counts[1] + counts[2];
+    }
+
+    std::array<uint64_t, 3> histogram() const
+    {
+        return box.histogram();
+    }
+
+    //================================================================================
+    // Method: view
+    // Description:
+    //     Read-only view of the current grid (row(y), at(x, y), data() and
+    //     stride()). No copy for flat storage; packed layouts decode into a
+    //     buffer that is reused until the next change. Invalidated by toggles.
+    //================================================================================
+    StateView view() const
+    {
+        return box.view();
+    }
+
+    //================================================================================
+    // Method: getState
+    // Description:
+    //     Returns a deep copy of the current grid state. Use it only when an
+    //     owning snapshot is needed, view() avoids the allocation.
+    //================================================================================
+    std::vector<std::vector<uint8_t>> getState() const
+    {
+        StateView current = box.view();
+        std::vector<std::vector<uint8_t>> state(ySize);
+        for (uint32_t y = 0; y < ySize; ++y)
+            state[y].assign(current.row(y), current.row(y) + xSize);
+        return state;
+    }
+
+    //================================================================================
+    // Method: lineSums
+    // Description:
+    //     Sum (mod 3) of every row and column of the grid, all the closed-form
+    //     line solver needs to know about the state.
+    //================================================================================
+    void lineSums(std::vector<int> &rowSum, std::vector<int> &colSum) const
+    {
+        std::vector<uint8_t> rows(ySize), columns(xSize);
+        box.lineSums(rows.data(), columns.data());
+        rowSum.assign(rows.begin(), rows.end());
+        colSum.assign(columns.begin(), columns.end());
+    }
+
+    //================================================================================
+    // Method: flush
+    // Description:
+    //     Materializes all deferred updates of a lazy storage in one O(W·H)
+    //     pass. Eager storages are always up to date.
+    //================================================================================
+    void flush()
+    {
+        box.flush();
+    }
+
+    uint32_t getWidth() const { return xSize; }
+    uint32_t getHeight() const { return ySize; }
+    const char *storageName() const { return Storage::name(); }
+
+private:
+
+    //================================================================================
+    // Method: shuffle
+    // Description:
+    //     Randomly toggles cells multiple times to generate
+    //     a scrambled starting configuration.
+    //================================================================================
+    void shuffle()
+    {
+        for (uint32_t t = rng() % 0x1000; t > 0; --t)
+            toggle(rng() % xSize, rng() % ySize);
+    }
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <time.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "packed_gf3.h"
+
+// Largest width and height with a compile-time SecureBoxFixed instantiation
+constexpr uint32_t FIXED_BOX_MAX_SIZE = 16;
+
+namespace fixed_box_detail
+{
+    constexpr size_t wordsFor(uint32_t width, uint32_t height)
+    {
+        return (static_cast<size_t>(width) * height + 63) / 64;
+    }
+
+    // Bit y * W + x set for every x of row y
+    template <uint32_t W, uint32_t H>
+    constexpr std::array<std::array<uint64_t, wordsFor(W, H)>, H> rowMasks()
+    {
+        std::array<std::array<uint64_t, wordsFor(W, H)>, H> masks{};
+        for (uint32_t y = 0; y < H; ++y)
+            for (uint32_t x = 0; x < W; ++x)
+            {
+                size_t cell = static_cast<size_t>(y) * W + x;
+                masks[y][cell >> 6] |= uint64_t(1) << (cell & 63);
+            }
+        return masks;
+    }
+
+    // Bit y * W + x set for every y of column x
+    template <uint32_t W, uint32_t H>
+    constexpr std::array<std::array<uint64_t, wordsFor(W, H)>, W> columnMasks()
+    {
+        std::array<std::array<uint64_t, wordsFor(W, H)>, W> masks{};
+        for (uint32_t x = 0; x < W; ++x)
+            for (uint32_t y = 0; y < H; ++y)
+            {
+                size_t cell = static_cast<size_t>(y) * W + x;
+                masks[x][cell >> 6] |= uint64_t(1) << (cell & 63);
+            }
+        return masks;
+    }
+
+    // SplitMix64, enough to scramble a box without an mt19937_64 state
+    inline uint64_t nextRandom(uint64_t &state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+}
+
+//================================================================================
+// Class: SecureBoxFixed
+// Description:
+//     SecureBox with its size fixed at compile time, for boxes up to
+//     FIXED_BOX_MAX_SIZE × FIXED_BOX_MAX_SIZE. The grid is bitsliced like
+//     BitslicedStorage, but over the whole box instead of per row: two
+//     std::arrays of ⌈W·H / 64⌉ words (at most 4), no heap at all.
+//
+//     A toggle adds 1 to every cell of row y and column x, the center
+//     included once (+1 +1 +2 = +1 mod 3), so it is one masked GF(3)
+//     increment per word with the mask rowMask[y] | columnMask[x], both
+//     constexpr tables. isLocked() is an OR over both planes. With the word
+//     count known to the compiler, loops over a small box keep the whole
+//     state in registers.
+//================================================================================
+template <uint32_t W, uint32_t H>
+class SecureBoxFixed
+{
+    static_assert(W >= 1 && H >= 1 && W <= FIXED_BOX_MAX_SIZE && H <= FIXED_BOX_MAX_SIZE,
+                  "SecureBoxFixed supports 1..FIXED_BOX_MAX_SIZE cells per side");
+
+public:
+    static constexpr uint32_t WIDTH = W;
+    static constexpr uint32_t HEIGHT = H;
+    static constexpr size_t WORDS = fixed_box_detail::wordsFor(W, H);
+
+private:
+    static constexpr auto ROW_MASKS = fixed_box_detail::rowMasks<W, H>();
+    static constexpr auto COLUMN_MASKS = fixed_box_detail::columnMasks<W, H>();
+
+    std::array<uint64_t, WORDS> ones{}, twos{};
+
+public:
+
+    //================================================================================
+    // Constructor: SecureBoxFixed
+    // Description:
+    //     Scrambles the box with pseudo-random toggles like SecureBox, seeded
+    //     from the clock unless a seed is given.
+    //================================================================================
+    explicit SecureBoxFixed(uint64_t seed = static_cast<uint64_t>(time(0)))
+    {
+        shuffle(seed);
+    }
+
+    //================================================================================
+    // Method: toggle
+    // Description:
+    //     Same effect as SecureBox::toggle: +1 (mod 3) on row y and column x.
+    //================================================================================
+    void toggle(uint32_t x, uint32_t y)
+    {
+        for (size_t w = 0; w < WORDS; ++w)
+        {
+            uint64_t mask = ROW_MASKS[y][w] | COLUMN_MASKS[x][w];
+            gf3::add(ones[w], twos[w], mask, 0, ones[w], twos[w]);
+        }
+    }
+
+    bool isLocked() const
+    {
+        uint64_t any = 0;
+        for (size_t w = 0; w < WORDS; ++w)
+            any |= ones[w] | twos[w];
+        return any != 0;
+    }
+
+    uint32_t lockedCount() const
+    {
+        uint32_t count = 0;
+        for (size_t w = 0; w < WORDS; ++w)
+            count += gf3::popCount(ones[w] | twos[w]);
+        return count;
+    }
+
+    uint8_t at(uint32_t x, uint32_t y) const
+    {
+        size_t cell = static_cast<size_t>(y) * W + x;
+        uint64_t bit = uint64_t(1) << (cell & 63);
+        return (ones[cell >> 6] & bit) ? 1 : (twos[cell >> 6] & bit) ? 2 : 0;
+    }
+
+    //================================================================================
+    // Method: lineSums
+    // Description:
+    //     Sum (mod 3) of every row and column, as SecureBox::lineSums. A row
+    //     or column sum is popcount(ones & mask) + 2 · popcount(twos & mask).
+    //================================================================================
+    void lineSums(std::vector<int> &rowSum, std::vector<int> &colSum) const
+    {
+        rowSum.assign(H, 0);
+        colSum.assign(W, 0);
+        for (uint32_t y = 0; y < H; ++y)
+            rowSum[y] = lineSum(ROW_MASKS[y]);
+        for (uint32_t x = 0; x < W; ++x)
+            colSum[x] = lineSum(COLUMN_MASKS[x]);
+    }
+
+    // The bit planes, WORDS words each, cell y * W + x at bit (cell & 63) of
+    // word cell >> 6
+    const uint64_t *onesPlane() const { return ones.data(); }
+    const uint64_t *twosPlane() const { return twos.data(); }
+
+    static constexpr uint32_t getWidth() { return W; }
+    static constexpr uint32_t getHeight() { return H; }
+    static const char *storageName() { return "fixed"; }
+
+private:
+    int lineSum(const std::array<uint64_t, WORDS> &mask) const
+    {
+        int sum = 0;
+        for (size_t w = 0; w < WORDS; ++w)
+            sum += gf3::popCount(ones[w] & mask[w]) + 2 * gf3::popCount(twos[w] & mask[w]);
+        return sum % 3;
+    }
+
+    void shuffle(uint64_t seed)
+    {
+        for (uint64_t t = fixed_box_detail::nextRandom(seed) % 0x1000; t > 0; --t)
+        {
+            uint64_t r = fixed_box_detail::nextRandom(seed);
+            toggle(static_cast<uint32_t>(r % W), static_cast<uint32_t>((r >> 32) % H));
+        }
+    }
+};
+
+//================================================================================
+// Struct: FixedSize
+// Description:
+//     Compile-time box size handed to the callbacks of dispatchFixedBox().
+//================================================================================
+template <uint32_t W, uint32_t H>
+struct FixedSize
+{
+    static constexpr uint32_t width = W;
+    static constexpr uint32_t height = H;
+    using Box = SecureBoxFixed<W, H>;
+};
+
+namespace fixed_box_detail
+{
+    template <typename F, typename R, size_t I>
+    R invokeFixed(F &f)
+    {
+        return f(FixedSize<I % FIXED_BOX_MAX_SIZE + 1, I / FIXED_BOX_MAX_SIZE + 1>{});
+    }
+
+    template <typename F, typename R, size_t... I>
+    constexpr std::array<R (*)(F &), sizeof...(I)> fixedTable(std::index_sequence<I...>)
+    {
+        return {&invokeFixed<F, R, I>...};
+    }
+}
+
+//================================================================================
+// Function: dispatchFixedBox
+// Description:
+//     Calls f(FixedSize<width, height>{}) for a size known only at run time,
+//     through a table of all FIXED_BOX_MAX_SIZE² instantiations of f. The
+//     size must be 1..FIXED_BOX_MAX_SIZE on both sides.
+//
+//         dispatchFixedBox(w, h, [](auto size) {
+//             typename decltype(size)::Box box;
+//             ...
+//         });
+//================================================================================
+template <typename F>
+auto dispatchFixedBox(uint32_t width, uint32_t height, F &&f)
+{
+    using Callback = std::remove_reference_t<F>;
+    using Result = decltype(f(FixedSize<1, 1>{}));
+    static constexpr auto table = fixed_box_detail::fixedTable<Callback, Result>(
+        std::make_index_sequence<FIXED_BOX_MAX_SIZE * FIXED_BOX_MAX_SIZE>{});
+    return table[(height - 1) * FIXED_BOX_MAX_SIZE + (width - 1)](f);
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "packed_gf3.h"
+#include "solve_result.h"
+
+//================================================================================
+// Class: SolutionEnumerator
+// Description:
+//     Walks every toggle vector p + Σ c_j N_j of a solvable result (particular
+//     solution p, nullspace basis N_j), one at a time, in the modular ternary
+//     Gray-code order of min_toggle_search.h: the base-3 counter of the
+//     coefficients is incremented and the lowest digit that did not wrap
+//     decides which basis vector is added. So every step is one bitsliced
+//     add of a single basis vector, and the int view of the solution is only
+//     patched in the cells that vector touches.
+//
+//     Nothing is materialized up front; memory is O(n + nullity) however
+//     many solutions there are, and the counter has no overflow at any
+//     nullity. Without a nullspace only the particular solution is visited.
+//
+//         for (SolutionEnumerator all(result); !all.done(); all.next())
+//             use(all.current());
+//
+//     or as an input range:
+//
+//         for (const std::vector<int> &solution : SolutionEnumerator(result))
+//             use(solution);
+//================================================================================
+class SolutionEnumerator
+{
+private:
+    std::shared_ptr<const PackedGF3Matrix> basis;
+    size_t words = 0;
+    std::vector<uint64_t> ones, twos; // current vector, bitsliced
+    std::vector<int> solution;        // current vector, one int per cell
+    std::vector<uint8_t> counter;     // base-3 digits, least significant first
+    uint64_t visited = 0;
+    bool finished;
+
+public:
+    explicit SolutionEnumerator(const SolveResult &result)
+        : basis(result.nullspace), solution(result.solution), finished(!result.solvable)
+    {
+        if (!basis || finished)
+            return;
+
+        words = basis->words();
+        ones.assign(words, 0);
+        twos.assign(words, 0);
+        for (size_t i = 0; i < solution.size(); ++i)
+            if (solution[i] == 1)
+                ones[i >> 6] |= uint64_t(1) << (i & 63);
+            else if (solution[i] == 2)
+                twos[i >> 6] |= uint64_t(1) << (i & 63);
+        counter.assign(basis->rows(), 0);
+    }
+
+    bool done() const { return finished; }
+    const std::vector<int> &current() const { return solution; }
+
+    // Solutions visited before the current one
+    uint64_t index() const { return visited; }
+
+    //================================================================================
+    // Method: next
+    // Description:
+    //     Moves to the next solution, returns false (and sets done()) after the
+    //     last one.
+    //================================================================================
+    bool next()
+    {
+        if (finished)
+            return false;
+
+        size_t digit = 0;
+        while (digit < counter.size() && counter[digit] == 2)
+            counter[digit++] = 0;
+        if (digit == counter.size())
+        {
+            finished = true;
+            return false;
+        }
+        ++counter[digit];
+        ++visited;
+
+        const uint64_t *b1 = basis->ones(digit), *b2 = basis->twos(digit);
+        for (size_t w = 0; w < words; ++w)
+        {
+            uint64_t changed = b1[w] | b2[w];
+            if (!changed)
+                continue;
+            gf3::add(ones[w], twos[w], b1[w], b2[w], ones[w], twos[w]);
+            for (; changed; changed &= changed - 1)
+            {
+                size_t bit = gf3::countTrailingZeros(changed);
+                uint64_t mask = uint64_t(1) << bit;
+                solution[w * 64 + bit] = (ones[w] & mask) ? 1 : (twos[w] & mask) ? 2 : 0;
+            }
+        }
+        return true;
+    }
+
+    //================================================================================
+    // Class: Iterator
+    // Description:
+    //     Input iterator over the enumerator it was taken from; advancing it
+    //     advances the enumerator.
+    //================================================================================
+    class Iterator
+    {
+    private:
+        SolutionEnumerator *owner;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::vector<int>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::vector<int> *;
+        using reference = const std::vector<int> &;
+
+        explicit Iterator(SolutionEnumerator *enumerator) : owner(enumerator) {}
+
+        reference operator*() const { return owner->current(); }
+        pointer operator->() const { return &owner->current(); }
+
+        Iterator &operator++()
+        {
+            owner->next();
+            return *this;
+        }
+
+        // Only end() compares meaningfully: equal once the walk is over
+        bool operator==(const Iterator &other) const
+        {
+            bool atEnd = !owner || owner->done();
+            bool otherAtEnd = !other.owner || other.owner->done();
+            return atEnd == otherAtEnd;
+        }
+        bool operator!=(const Iterator &other) const { return !(*this == other); }
+    };
+
+    Iterator begin() { return Iterator(this); }
+    Iterator end() { return Iterator(nullptr); }
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "packed_gf3.h"
+
+//================================================================================
+// Struct: SolveResult
+// Description:
+//     Outcome of solving "effect * toggles = target" over GF(3) (or Z_n,
+//     see modular_solver.h).
+//         solvable  → false when the target is outside the range of the
+//                     operator; known right after elimination, before any
+//                     toggle is replayed
+//         rank      → rank of the effect matrix (0 when a matrix-free
+//                     Wiedemann solve could not determine it)
+//         nullity   → the system has 3^nullity distinct solutions when solvable
+//                     (0 as well when the rank is unknown)
+//         solution  → a particular solution, toggle counts (0..2) per cell,
+//                     row-major (y * width + x), free unknowns set to 0
+//         nullspace → basis of the kernel of the effect matrix, one
+//                     bitsliced row of cols() unknowns per vector; every
+//                     solution is solution + Σ c_i · nullspace row i.
+//                     Shared, since it depends on the matrix only (a batch
+//                     solve hands the same basis to every box). nullptr
+//                     when the solver does not compute it (Wiedemann,
+//                     cached factorizations, the closed form, whose basis
+//                     closedFormNullspace gives on request).
+//================================================================================
+struct SolveResult
+{
+    bool solvable = false;
+    uint32_t rank = 0;
+    uint32_t nullity = 0;
+    std::vector<int> solution;
+    std::shared_ptr<const PackedGF3Matrix> nullspace;
+};
@@ -0,0 +1,874 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "closed_form_solver.h"
+#include "factorization_cache.h"
+#include "fixed_closed_form.h"
+#include "m4ri_solver.h"
+#include "modular_solver.h"
+#include "packed_solver.h"
+#include "parallel_solver.h"
+#include "solve_result.h"
+#include "sparse_gf3.h"
+#include "toggle_operator.h"
+#include "wiedemann_solver.h"
+
+//================================================================================
+// Solver registry
+//================================================================================
+// Every backend able to solve A t = b for a box registers here with
+//
+//     supports(query)      whether it handles the toggle rule and box size
+//     memory(query)        bytes it allocates for the solve, fill-in included
+//     solve(query, target) the solve itself, effect matrix construction included
+//     reset()              optional, drops what the backend keeps between solves
+//
+// and a cost model seconds = c + a · n^k over the n = W·H cells. The constant
+// c is the setup every solve pays (allocations, building the matrix or the
+// operator); without it an O(n³) backend looks cheaper than an O(n) one on
+// small boxes. select() drops the backends that do not support the query or
+// exceed its memory budget and picks the cheapest prediction among the rest.
+// The models start from built-in estimates; calibrate() times every backend
+// on this host and fits c, a and k by least squares on the relative error,
+// weighted by the cells so the large boxes decide the fit.
+// A profile file keeps the fit:
+//
+//     # SecureBox solver profile: seconds = c + a * cells^k
+//     closed-form 2.2e-07 2.8e-09 1.01
+//     packed 7.4e-07 6.5e-11 2.76
+//================================================================================
+
+// Memory a solve may allocate unless the caller says otherwise
+constexpr uint64_t DEFAULT_SOLVER_MEMORY_BUDGET = uint64_t(1) << 30;
+
+//================================================================================
+// Function: solverWorkers
+// Description:
+//     Threads a solve may use for a --threads style setting: the setting
+//     itself, or one per hardware thread when it is 0.
+//================================================================================
+inline unsigned solverWorkers(unsigned threads)
+{
+    return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+//================================================================================
+// Struct: SolverQuery
+// Description:
+//     What select() chooses a backend for: the box size, the toggle rule
+//     (the SecureBox row/column rule when stencil is null), how many bytes
+//     the solve may allocate and how many threads it may use (0 = one per
+//     hardware thread). Backends note anything beyond the plain solve, like
+//     a fallback to another method, on log when it is set.
+//================================================================================
+struct SolverQuery
+{
+    uint32_t width = 0, height = 0;
+    const StencilToggleOperator *stencil = nullptr;
+    uint64_t memoryBudget = DEFAULT_SOLVER_MEMORY_BUDGET;
+    std::ostream *log = nullptr;
+    unsigned threads = 0;
+
+    size_t cells() const { return static_cast<size_t>(width) * height; }
+
+    unsigned workers() const { return solverWorkers(threads); }
+};
+
+//================================================================================
+// Struct: CostModel
+// Description:
+//     Predicted solve time overhead + coefficient · cells^exponent in
+//     seconds. calibrated is set once the numbers come from this host.
+//================================================================================
+struct CostModel
+{
+    double overhead = 0;
+    double coefficient = 0;
+    double exponent = 0;
+    bool calibrated = false;
+
+    double predict(size_t cells) const
+    {
+        return overhead + coefficient * std::pow(static_cast<double>(cells), exponent);
+    }
+};
+
+struct SolverBackend
+{
+    std::string name;
+    std::function<bool(const SolverQuery &)> supports;
+    std::function<uint64_t(const SolverQuery &)> memory;
+    std::function<SolveResult(const SolverQuery &, const std::vector<int> &)> solve;
+    CostModel cost;
+    std::function<void()> reset;
+};
+
+//================================================================================
+// Struct: SolverChoice
+// Description:
+//     Result of select(): the chosen backend (null when none fits) with its
+//     predictions, and every backend that was considered. rejected is null
+//     for eligible candidates, otherwise the reason they were dropped.
+//================================================================================
+struct SolverChoice
+{
+    struct Candidate
+    {
+        const SolverBackend *backend;
+        double seconds;
+        uint64_t bytes;
+        const char *rejected;
+    };
+
+    const SolverBackend *backend = nullptr;
+    double predictedSeconds = 0;
+    uint64_t predictedBytes = 0;
+    std::vector<Candidate> candidates;
+};
+
+namespace solver_registry_detail
+{
+    // Box sides tried by calibrate(), square boxes of roughly doubling area;
+    // the tiny ones pin down the fixed overhead of every backend
+    constexpr uint32_t CALIBRATION_SIDES[] = {1, 2, 4, 6, 8, 11, 16, 23, 32, 45, 64, 91, 128, 181, 256};
+
+    // A solve, or first solve, slower than this ends the calibration of its backend
+    constexpr double CALIBRATION_SAMPLE_LIMIT = 0.25;
+
+    // Fast solves are repeated until they took this long together
+    constexpr double CALIBRATION_MIN_TIME = 0.005;
+
+    // A fit that predicts the largest sample off by more than this factor
+    // is rejected
+    constexpr double FIT_TOLERANCE = 2;
+
+    // Boxes with deep nilpotent blocks in the toggle operator, where
+    // randomized solvers used to reject reachable targets, and a nonsingular
+    // one (9×11) for the backends that only take those
+    constexpr uint32_t CHECK_SIZES[][2] = {{6, 4}, {4, 9}, {13, 9}, {15, 10}, {9, 11}};
+    constexpr int CHECK_TARGETS = 30;
+
+    inline bool rowColumnRule(const SolverQuery &query)
+    {
+        return query.stencil == nullptr;
+    }
+
+    // Calls f with the toggle operator of the query's rule
+    template <typename F>
+    auto withOperator(const SolverQuery &query, F f)
+    {
+        if (query.stencil)
+            return f(*query.stencil);
+        return f(RowColumnToggleOperator(query.width, query.height));
+    }
+
+    // Effect matrix of any toggle rule, one operator application per column
+    template <typename Operator, typename F>
+    void forEachColumn(const Operator &op, F column)
+    {
+        size_t n = op.size();
+        std::vector<uint8_t> unit(n, 0), delta;
+        for (size_t c = 0; c < n; ++c)
+        {
+            unit[c] = 1;
+            op.apply(unit, delta);
+            unit[c] = 0;
+            column(c, delta);
+        }
+    }
+
+    inline PackedGF3Matrix packedMatrix(const SolverQuery &query)
+    {
+        if (rowColumnRule(query))
+            return buildPackedEffectMatrix(query.width, query.height);
+
+        PackedGF3Matrix matrix(query.cells(), query.cells());
+        forEachColumn(*query.stencil, [&](size_t c, const std::vector<uint8_t> &delta) {
+            for (size_t r = 0; r < delta.size(); ++r)
+                if (delta[r])
+                    matrix.set(r, c, delta[r]);
+        });
+        return matrix;
+    }
+
+    inline SparseGF3Matrix sparseMatrix(const SolverQuery &query)
+    {
+        if (rowColumnRule(query))
+            return buildSparseEffectMatrix(query.width, query.height);
+
+        return buildSparseOperatorMatrix(*query.stencil);
+    }
+
+    inline std::vector<std::vector<int>> denseMatrix(const SolverQuery &query)
+    {
+        size_t n = query.cells();
+        std::vector<std::vector<int>> matrix(n, std::vector<int>(n, 0));
+        withOperator(query, [&](const auto &op) {
+            forEachColumn(op, [&](size_t c, const std::vector<uint8_t> &delta) {
+                for (size_t r = 0; r < n; ++r)
+                    matrix[r][c] = delta[r];
+            });
+            return 0;
+        });
+        return matrix;
+    }
+
+    // Augmented packed matrix plus the copy it is built from
+    inline uint64_t packedBytes(const SolverQuery &query)
+    {
+        uint64_t n = query.cells();
+        return 2 * (2 * n * gf3::wordsFor(n + 1) * sizeof(uint64_t));
+    }
+
+    // Peak of building a GF3Factorization from the packed matrix A: [A | I],
+    // twice as wide as A, next to A while it is built and next to the
+    // transform T (A's size) or the M4RI table of 3^k rows of [A | I] after
+    inline uint64_t factorizationBytes(const SolverQuery &query)
+    {
+        uint64_t n = query.cells();
+        uint64_t words = gf3::wordsFor(n);
+        uint64_t matrix = n * 2 * words * sizeof(uint64_t);
+        uint64_t augmented = n * 2 * (2 * words) * sizeof(uint64_t);
+        uint64_t table = m4ri_detail::power3(m4riBlockSize(n)) * 2 * (2 * words) * sizeof(uint64_t);
+        return augmented + std::max(matrix, table);
+    }
+
+    inline uint64_t stencilNonZeros(const SolverQuery &query)
+    {
+        uint64_t perColumn = rowColumnRule(query) ? uint64_t(query.width) + query.height - 1 : query.stencil->entries();
+        return query.cells() * perColumn;
+    }
+
+    // Matrix, row lists and column index of the sparse elimination. Measured
+    // peaks on row/column boxes up to 64×64 are 2.5-3.6× that with the
+    // Markowitz fill-in, so the estimate allows 4×.
+    inline uint64_t sparseBytes(const SolverQuery &query)
+    {
+        return 4 * stencilNonZeros(query) * (2 * sizeof(uint32_t) + 2 * sizeof(uint8_t) + sizeof(size_t));
+    }
+
+    //================================================================================
+    // Function: builtinBackends
+    // Description:
+    //     Every solver of the tree with the cost model calibrate() fitted on
+    //     a ~3 GHz x86-64 core at -O2, used until a profile or calibrate()
+    //     replaces it. The dense reference solver is registered too, it
+    //     converts to the packed form and can only win when a profile says
+    //     so. packed-parallel was timed with two workers on that one core,
+    //     which only gives its thread start-up; its slope is packed's until
+    //     calibrate() measures the speedup of the host.
+    //================================================================================
+    inline std::vector<SolverBackend> builtinBackends()
+    {
+        std::vector<SolverBackend> backends;
+
+        backends.push_back({"fixed-closed-form",
+                            [](const SolverQuery &q) {
+                                return rowColumnRule(q) && q.width <= FIXED_BOX_MAX_SIZE &&
+                                       q.height <= FIXED_BOX_MAX_SIZE;
+                            },
+                            [](const SolverQuery &q) { return uint64_t(q.cells()) * 2 * sizeof(int); },
+                            [](const SolverQuery &q, const std::vector<int> &target) {
+                                return solveFixedClosedForm(q.width, q.height, target);
+                            },
+                            {1.1e-7, 6.2e-9, 0.83}});
+
+        backends.push_back({"closed-form", rowColumnRule,
+                            [](const SolverQuery &q) { return uint64_t(q.cells()) * 2 * sizeof(int); },
+                            [](const SolverQuery &q, const std::vector<int> &target) {
+                                return solveClosedForm(q.width, q.height, target);
+                            },
+                            {2.2e-7, 2.8e-9, 1.01}});
+
+        backends.push_back({"packed", [](const SolverQuery &) { return true; }, packedBytes,
+                            [](const SolverQuery &q, const std::vector<int> &target) {
+                                return solvePackedLinearSystem(packedMatrix(q), target);
+                            },
+                            {7.4e-7, 6.5e-11, 2.76}});
+
+        // The multi-threaded backends start a pool of q.workers() threads per
+        // solve, which their overhead c accounts for; with one worker the
+        // threaded elimination is the packed one and is not offered
+        backends.push_back({"packed-parallel", [](const SolverQuery &q) { return q.workers() > 1; }, packedBytes,
+                            [](const SolverQuery &q, const std::vector<int> &target) {
+                                return solvePackedLinearSystemParallel(packedMatrix(q), target, q.workers());
+                            },
+                            {4.1e-5, 6.5e-11, 2.76}});
+
+        backends.push_back({"m4ri", [](const SolverQuery &) { return true; },
+                            [](const SolverQuery &q) {
+                                // Plus the 3^k row combinations of one block
+                                uint64_t n = q.cells();
+                                return packedBytes(q) + 729 * 2 * gf3::wordsFor(n + 1) * sizeof(uint64_t);
+                            },
+                            [](const SolverQuery &q, const std::vector<int> &target) {
+                                if (q.workers() == 1)
+                                    return solvePackedLinearSystemM4RI(packedMatrix(q), target);
+                                WorkerPool pool(q.workers());
+                                return solvePackedLinearSystemM4RI(packedMatrix(q), target, 0, &pool);
+                            },
+                            {7.3e-6, 4.2e-9, 2.14}});
+
+        backends.push_back({"sparse", [](const SolverQuery &) { return true; },
+                            sparseBytes,
+                            [](const SolverQuery &q, const std::vector<int> &target) {
+                                return solveSparseLinearSystem(sparseMatrix(q), target);
+                            },
+                            {9.4e-7, 8.6e-9, 2.03}});
+
+        // Nonsingular boxes only, see wiedemann_solver.h
+        backends.push_back({"wiedemann",
+                            [](const SolverQuery &q) {
+                                return rowColumnRule(q) && closedFormNullity(q.width, q.height) == 0;
+                            },
+                            [](const SolverQuery &q) {
+                                // Projections, their 2n-term sequences and a few work vectors
+                                uint64_t n = q.cells();
+                                return n * (3 * wiedemann_detail::PROJECTIONS + 8);
+                            },
+                            [](const SolverQuery &q, const std::vector<int> &target) {
+                                WiedemannReport report;
+                                SolveResult result = withOperator(q, [&](const auto &op) {
+                                    return solveWiedemann(op, target, 0x5eedb0c5, 12, &report);
+                                });
+                                if (!report.converged && q.log)
+                                    *q.log << "wiedemann: " << report.rounds << " rounds left a residual" << std::endl;
+
+                                // The matrix-free path cannot tell the rank, the box is nonsingular
+                                if (report.converged)
+                                    result.rank = static_cast<uint32_t>(q.cells());
+                                return result;
+                            },
+                            {8.7e-7, 4.1e-8, 1.89}});
+
+        backends.push_back({"dense", [](const SolverQuery &) { return true; },
+                            [](const SolverQuery &q) {
+                                uint64_t n = q.cells();
+                                return n * n * sizeof(int) + packedBytes(q);
+                            },
+                            [](const SolverQuery &q, const std::vector<int> &target) {
+                                return solveModular<3>(denseMatrix(q), target);
+                            },
+                            {1.5e-6, 9.2e-10, 2.46}});
+
+        return backends;
+    }
+
+    // Names the toggle rule in factorization file names: the SecureBox rule,
+    // or a stencil by a hash of its entries
+    inline std::string ruleTag(const SolverQuery &query)
+    {
+        if (rowColumnRule(query))
+            return "rowcolumn";
+        uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a
+        for (const auto &entry : query.stencil->pattern())
+            for (int64_t field : {int64_t(entry.dx), int64_t(entry.dy), int64_t(entry.amount)})
+            {
+                hash ^= static_cast<uint64_t>(field);
+                hash *= 0x100000001b3ull;
+            }
+        std::ostringstream tag;
+        tag << "stencil-" << std::hex << hash;
+        return tag.str();
+    }
+
+    //================================================================================
+    // Class: FactorizedCaches
+    // Description:
+    //     One FactorizationCache per toggle rule, each backed by a
+    //     FactorizationStore in the rule's files. Shared by every copy of a
+    //     factorized backend, so a size is mapped and checksummed once per
+    //     process and later solves are hits in memory.
+    //================================================================================
+    class FactorizedCaches
+    {
+    private:
+        std::filesystem::path directory;
+        std::mutex lock;
+        std::map<std::string, std::shared_ptr<FactorizationCache>> byRule;
+
+    public:
+        explicit FactorizedCaches(std::filesystem::path cacheDirectory) : directory(std::move(cacheDirectory)) {}
+
+        std::shared_ptr<FactorizationCache> forRule(const SolverQuery &query)
+        {
+            std::string tag = ruleTag(query);
+            std::lock_guard<std::mutex> guard(lock);
+            auto &cache = byRule[tag];
+            if (cache)
+                return cache;
+
+            FactorizationCache::Builder build = buildPackedEffectMatrix;
+            if (!rowColumnRule(query))
+                build = [pattern = query.stencil->pattern()](uint32_t width, uint32_t height) {
+                    StencilToggleOperator op(width, height, pattern);
+                    return packedMatrix(SolverQuery{width, height, &op});
+                };
+            auto store = std::make_shared<const FactorizationStore>(directory, uint64_t(4) << 30, tag);
+            cache = std::make_shared<FactorizationCache>(std::move(build), std::move(store));
+            return cache;
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (auto &entry : byRule)
+                entry.second->clear();
+        }
+    };
+
+    //================================================================================
+    // Function: factorizedBackend
+    // Description:
+    //     Solves from a GF3Factorization kept in cacheDirectory by a
+    //     FactorizationStore, one file per rule and size. The first solve of
+    //     a size factors and saves it; later ones in the next process map the
+    //     file, and in this one reuse it from memory, leaving only the O(n²)
+    //     substitution. reset() empties the memory caches, so calibrate()
+    //     can time a cold load from disk. Meant for rules without a closed
+    //     form; on the row/column rule it loses to the line-sum solvers.
+    //================================================================================
+    inline SolverBackend factorizedBackend(std::filesystem::path cacheDirectory)
+    {
+        auto caches = std::make_shared<FactorizedCaches>(std::move(cacheDirectory));
+        return {"factorized", [](const SolverQuery &) { return true; }, factorizationBytes,
+                [caches](const SolverQuery &q, const std::vector<int> &target) {
+                    return caches->forRule(q)->solve(q.width, q.height, target);
+                },
+                {3.0e-7, 9.0e-10, 1.83}, [caches] { caches->clear(); }};
+    }
+
+    //================================================================================
+    // Function: fitOverheadAndCoefficient
+    // Description:
+    //     For a fixed exponent k, the c, a ≥ 0 minimizing Σ n · ((c + a·n^k) / t - 1)²
+    //     over (n, t) samples: the relative error, weighted by the cells so
+    //     the large boxes, where the choice of backend matters, decide the
+    //     fit rather than the microsecond solves. Returns that error sum.
+    //================================================================================
+    inline double fitOverheadAndCoefficient(const std::vector<std::pair<double, double>> &samples, double exponent,
+                                            double &overhead, double &coefficient)
+    {
+        // Rows √n · (1/t, n^k/t) against a right-hand side of √n
+        double s11 = 0, s12 = 0, s22 = 0, r1 = 0, r2 = 0, weights = 0;
+        for (const auto &sample : samples)
+        {
+            double w = sample.first;
+            double u = 1 / sample.second, v = std::pow(sample.first, exponent) / sample.second;
+            s11 += w * u * u;
+            s12 += w * u * v;
+            s22 += w * v * v;
+            r1 += w * u;
+            r2 += w * v;
+            weights += w;
+        }
+
+        double det = s11 * s22 - s12 * s12;
+        overhead = det > 0 ? (r1 * s22 - r2 * s12) / det : -1;
+        coefficient = det > 0 ? (s11 * r2 - s12 * r1) / det : -1;
+        if (overhead < 0 || coefficient < 0)
+        {
+            // One of them at the boundary: the better of the one-term fits
+            double onlyOverhead = r1 / s11, onlyCoefficient = r2 / s22;
+            double errorOverhead = weights - r1 * onlyOverhead;
+            double errorCoefficient = weights - r2 * onlyCoefficient;
+            overhead = errorOverhead < errorCoefficient ? onlyOverhead : 0;
+            coefficient = errorOverhead < errorCoefficient ? 0 : onlyCoefficient;
+        }
+
+        double error = 0;
+        for (const auto &sample : samples)
+        {
+            double ratio = (overhead + coefficient * std::pow(sample.first, exponent)) / sample.second - 1;
+            error += sample.first * ratio * ratio;
+        }
+        return error;
+    }
+
+    //================================================================================
+    // Function: fitCostModel
+    // Description:
+    //     Fits seconds = c + a · n^k to (cells, seconds) samples: c and a by
+    //     weighted linear least squares for every k on a grid of 0.01 steps
+    //     over [0, 4], keeping the best k. A fit that misses the largest
+    //     sample by more than FIT_TOLERANCE is rejected; it, and one or two
+    //     samples, which cannot pin down three parameters, only rescale the
+    //     prior to the largest sample. No sample keeps the prior.
+    //================================================================================
+    inline CostModel fitCostModel(const std::vector<std::pair<double, double>> &samples, const CostModel &prior)
+    {
+        if (samples.empty())
+            return prior;
+
+        auto largest = std::max_element(samples.begin(), samples.end(),
+                                        [](const auto &a, const auto &b) { return a.first < b.first; });
+        CostModel model = prior;
+        model.calibrated = true;
+
+        if (samples.size() >= 3)
+        {
+            double bestError = -1;
+            for (int step = 0; step <= 400; ++step)
+            {
+                double exponent = step * 0.01, overhead, coefficient;
+                double error = fitOverheadAndCoefficient(samples, exponent, overhead, coefficient);
+                if (bestError < 0 || error < bestError)
+                {
+                    bestError = error;
+                    model.overhead = overhead;
+                    model.coefficient = coefficient;
+                    model.exponent = exponent;
+                }
+            }
+
+            double ratio = model.predict(static_cast<size_t>(largest->first)) / largest->second;
+            if (ratio <= FIT_TOLERANCE && ratio >= 1 / FIT_TOLERANCE)
+                return model;
+            model = prior;
+            model.calibrated = true;
+        }
+
+        double scale = largest->second / prior.predict(static_cast<size_t>(largest->first));
+        model.overhead *= scale;
+        model.coefficient *= scale;
+        return model;
+    }
+
+    // A·t for random toggles t: a target every backend has to solve
+    inline std::vector<int> reachableTarget(uint32_t width, uint32_t height, std::mt19937_64 &rng)
+    {
+        std::vector<uint8_t> toggles(static_cast<size_t>(width) * height), state;
+        for (auto &t : toggles)
+            t = static_cast<uint8_t>(rng() % 3);
+        RowColumnToggleOperator(width, height).apply(toggles, state);
+        return std::vector<int>(state.begin(), state.end());
+    }
+
+    // Whether the result is a solution of A t = target for the row/column rule
+    inline bool verifiesSolution(uint32_t width, uint32_t height, const std::vector<int> &target,
+                                 const SolveResult &result)
+    {
+        if (!result.solvable || result.solution.size() != target.size())
+            return false;
+        std::vector<uint8_t> toggles(target.size()), delta;
+        for (size_t i = 0; i < target.size(); ++i)
+            toggles[i] = static_cast<uint8_t>(((result.solution[i] % 3) + 3) % 3);
+        RowColumnToggleOperator(width, height).apply(toggles, delta);
+        for (size_t i = 0; i < target.size(); ++i)
+            if (delta[i] != ((target[i] % 3) + 3) % 3)
+                return false;
+        return true;
+    }
+
+    inline std::string formatSeconds(double seconds)
+    {
+        std::ostringstream out;
+        out.precision(3);
+        if (seconds < 1)
+            out << seconds * 1000 << " ms";
+        else
+            out << seconds << " s";
+        return out.str();
+    }
+
+    inline std::string formatBytes(uint64_t bytes)
+    {
+        const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+        size_t unit = 0;
+        double value = static_cast<double>(bytes);
+        while (value >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0]))
+        {
+            value /= 1024;
+            ++unit;
+        }
+        std::ostringstream out;
+        out.precision(3);
+        out << value << " " << units[unit];
+        return out.str();
+    }
+}
+
+//================================================================================
+// Class: SolverRegistry
+// Description:
+//     The solver backends with their cost models. Starts with the built-in
+//     backends; add() registers more or replaces one of the same name.
+//================================================================================
+class SolverRegistry
+{
+private:
+    std::vector<SolverBackend> backends;
+    std::string source = "built-in estimates";
+
+public:
+    SolverRegistry() : backends(solver_registry_detail::builtinBackends()) {}
+
+    void add(SolverBackend backend)
+    {
+        for (auto &existing : backends)
+            if (existing.name == backend.name)
+            {
+                existing = std::move(backend);
+                return;
+            }
+        backends.push_back(std::move(backend));
+    }
+
+    const std::vector<SolverBackend> &all() const { return backends; }
+
+    // Where the cost models come from: built-in, a profile file or calibrate()
+    const std::string &profileSource() const { return source; }
+
+    //================================================================================
+    // Method: select
+    // Description:
+    //     Picks the eligible backend with the lowest predicted time. Ties go to
+    //     the backend registered first.
+    //================================================================================
+    SolverChoice select(const SolverQuery &query) const
+    {
+        SolverChoice choice;
+        for (const auto &backend : backends)
+        {
+            SolverChoice::Candidate candidate{&backend, 0, 0, nullptr};
+            if (!backend.supports(query))
+                candidate.rejected = "toggle rule or size not supported";
+            else
+            {
+                candidate.bytes = backend.memory(query);
+                candidate.seconds = backend.cost.predict(query.cells());
+                if (candidate.bytes > query.memoryBudget)
+                    candidate.rejected = "over memory budget";
+                else if (!choice.backend || candidate.seconds < choice.predictedSeconds)
+                {
+                    choice.backend = &backend;
+                    choice.predictedSeconds = candidate.seconds;
+                    choice.predictedBytes = candidate.bytes;
+                }
+            }
+            choice.candidates.push_back(candidate);
+        }
+        return choice;
+    }
+
+    //================================================================================
+    // Method: describe
+    // Description:
+    //     One line per considered backend for the log, the chosen one marked
+    //     with '*', e.g.
+    //         * fixed-closed-form     0.0002 ms       512 B  (calibrated)
+    //           packed                  1.31 ms      64 KiB
+    //           dense              over memory budget
+    //================================================================================
+    std::string describe(const SolverChoice &choice) const
+    {
+        using namespace solver_registry_detail;
+
+        std::ostringstream out;
+        for (const auto &candidate : choice.candidates)
+        {
+            out << (candidate.backend == choice.backend ? "  * " : "    ");
+            out.width(19);
+            out << std::left << candidate.backend->name << std::right;
+            if (candidate.rejected && candidate.bytes == 0)
+                out << candidate.rejected;
+            else
+            {
+                out.width(12);
+                out << formatSeconds(candidate.seconds) << "  ";
+                out.width(10);
+                out << formatBytes(candidate.bytes);
+                if (candidate.rejected)
+                    out << "  " << candidate.rejected;
+                else if (candidate.backend->cost.calibrated)
+                    out << "  (calibrated)";
+            }
+            out << "\n";
+        }
+        return out.str();
+    }
+
+    //================================================================================
+    // Method: loadProfile
+    // Description:
+    //     Reads "name overhead coefficient exponent" lines written by
+    //     saveProfile();
+    //     '#' starts a comment and unknown names are skipped. Returns false
+    //     and keeps the current models when the file is missing or malformed.
+    //================================================================================
+    bool loadProfile(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+
+        std::vector<SolverBackend> loaded = backends;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            std::string name;
+            CostModel model;
+            if (!(fields >> name))
+                continue;
+            if (!(fields >> model.overhead >> model.coefficient >> model.exponent) || model.overhead < 0 ||
+                model.coefficient < 0 || model.exponent < 0)
+                return false;
+            model.calibrated = true;
+
+            for (auto &backend : loaded)
+                if (backend.name == name)
+                    backend.cost = model;
+        }
+
+        backends = std::move(loaded);
+        source = path;
+        return true;
+    }
+
+    //================================================================================
+    // Method: saveProfile
+    // Description:
+    //     Writes the calibrated models, see loadProfile(). Returns false when
+    //     the file cannot be written.
+    //================================================================================
+    bool saveProfile(const std::string &path) const
+    {
+        std::ofstream out(path);
+        if (!out)
+            return false;
+
+        out << "# SecureBox solver profile: seconds = c + a * cells^k\n";
+        out << "# backend c a k\n";
+        out.precision(6);
+        for (const auto &backend : backends)
+            if (backend.cost.calibrated)
+                out << backend.name << " " << backend.cost.overhead << " " << backend.cost.coefficient << " "
+                    << backend.cost.exponent << "\n";
+        return static_cast<bool>(out);
+    }
+
+    //================================================================================
+    // Method: calibrate
+    // Description:
+    //     Times every backend on square row/column boxes of growing size,
+    //     each on a random reachable target A·t, and fits its cost model to
+    //     all samples, so fixed overheads of small boxes are averaged in.
+    //     Only the solves are timed; the answer of the last one is verified
+    //     afterwards. Sizes stop when a solve, or the untimed first solve,
+    //     takes longer than CALIBRATION_SAMPLE_LIMIT, or the next one
+    //     exceeds the memory budget. The first solve counts since it can be
+    //     far slower than the rest, like the factorized backend's, which
+    //     factors the box before later solves load it. threads is passed to
+    //     the backends in every query. Progress goes to log.
+    //
+    //     Every backend first has to solve CHECK_TARGETS reachable targets on
+    //     each of the CHECK_SIZES boxes, answers verified through the toggle
+    //     operator. Returns false when any backend failed that check; its
+    //     model is still fitted, but the profile should not be trusted.
+    //================================================================================
+    bool calibrate(std::ostream &log, uint64_t memoryBudget = DEFAULT_SOLVER_MEMORY_BUDGET, unsigned threads = 0,
+                   uint64_t seed = 0xca11b7a7)
+    {
+        using namespace solver_registry_detail;
+        using Clock = std::chrono::steady_clock;
+        auto since = [](Clock::time_point start) {
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        std::mt19937_64 rng(seed);
+        bool allCorrect = true;
+        for (auto &backend : backends)
+        {
+            for (const auto &size : CHECK_SIZES)
+            {
+                SolverQuery query{size[0], size[1], nullptr, memoryBudget, nullptr, threads};
+                if (!backend.supports(query) || backend.memory(query) > memoryBudget)
+                    continue;
+
+                int failed = 0;
+                for (int i = 0; i < CHECK_TARGETS; ++i)
+                {
+                    std::vector<int> target = reachableTarget(size[0], size[1], rng);
+                    if (!verifiesSolution(size[0], size[1], target, backend.solve(query, target)))
+                        ++failed;
+                }
+                if (failed)
+                {
+                    log << "  " << backend.name << " " << size[0] << "x" << size[1] << ": " << failed << "/"
+                        << CHECK_TARGETS << " reachable targets not solved" << std::endl;
+                    allCorrect = false;
+                }
+            }
+
+            std::vector<std::pair<double, double>> samples;
+            for (uint32_t side : CALIBRATION_SIDES)
+            {
+                SolverQuery query{side, side, nullptr, memoryBudget, nullptr, threads};
+                if (!backend.supports(query))
+                    continue; // e.g. singular sides for wiedemann
+                if (backend.memory(query) > memoryBudget)
+                    break;
+
+                std::vector<int> target = reachableTarget(side, side, rng);
+
+                // First solve: page faults, and caches such as the
+                // factorized backend's files, are set up before timing;
+                // reset() makes that a cold load of what earlier sides saved
+                if (backend.reset)
+                    backend.reset();
+                auto start = Clock::now();
+                SolveResult result = backend.solve(query, target);
+                double firstSeconds = since(start);
+
+                size_t runs = 0;
+                double elapsed = 0;
+                start = Clock::now();
+                do
+                {
+                    result = backend.solve(query, target);
+                    ++runs;
+                    elapsed = since(start);
+                } while (elapsed < CALIBRATION_MIN_TIME);
+
+                double seconds = elapsed / runs;
+                bool solved = verifiesSolution(side, side, target, result);
+                log << "  " << backend.name << " " << side << "x" << side << ": " << formatSeconds(seconds);
+                if (firstSeconds > 2 * seconds && firstSeconds > CALIBRATION_MIN_TIME)
+                    log << " (first " << formatSeconds(firstSeconds) << ")";
+                log << (solved ? "" : " (not solved, skipped)") << std::endl;
+                if (solved)
+                    samples.emplace_back(static_cast<double>(query.cells()), seconds);
+                else
+                    allCorrect = false;
+                if (seconds > CALIBRATION_SAMPLE_LIMIT || firstSeconds > CALIBRATION_SAMPLE_LIMIT)
+                    break;
+            }
+
+            backend.cost = fitCostModel(samples, backend.cost);
+            log << backend.name << ": seconds = " << backend.cost.overhead << " + " << backend.cost.coefficient
+                << " * cells^" << backend.cost.exponent << std::endl;
+        }
+        source = "calibration";
+        return allCorrect;
+    }
+};
@@ -0,0 +1,323 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "solve_result.h"
+
+//================================================================================
+// Class: SparseGF3Matrix
+// Description:
+//     GF(3) matrix in compressed sparse column form: the nonzeros of column c
+//     are rowIndex[colStart[c] .. colStart[c + 1]) with their values in
+//     values[]. Row indices are sorted inside every column.
+//     The toggle effect matrix has W + H - 1 nonzeros per column, so this
+//     takes O(n·(W + H)) memory instead of the n² of the dense form.
+//================================================================================
+class SparseGF3Matrix
+{
+private:
+    size_t rowCount = 0, colCount = 0;
+    std::vector<size_t> colStart{0};
+    std::vector<uint32_t> rowIndex;
+    std::vector<uint8_t> values;
+
+public:
+    SparseGF3Matrix() = default;
+
+    //================================================================================
+    // Method: fromColumns
+    // Description:
+    //     Builds the matrix column by column. column(c, emit) must call
+    //     emit(row, value) for the entries of column c; duplicates are summed
+    //     mod 3 and zeros dropped.
+    //================================================================================
+    template <typename ColumnEntries>
+    static SparseGF3Matrix fromColumns(size_t rows, size_t cols, ColumnEntries column)
+    {
+        SparseGF3Matrix matrix;
+        matrix.rowCount = rows;
+        matrix.colCount = cols;
+        matrix.colStart.reserve(cols + 1);
+
+        std::vector<std::pair<uint32_t, uint8_t>> entries;
+        for (size_t c = 0; c < cols; ++c)
+        {
+            entries.clear();
+            column(c, [&](size_t row, int value) {
+                entries.emplace_back(static_cast<uint32_t>(row), static_cast<uint8_t>(((value % 3) + 3) % 3));
+            });
+            std::sort(entries.begin(), entries.end(),
+                      [](const auto &a, const auto &b) { return a.first < b.first; });
+
+            for (size_t i = 0; i < entries.size();)
+            {
+                uint32_t row = entries[i].first;
+                int sum = 0;
+                for (; i < entries.size() && entries[i].first == row; ++i)
+                    sum += entries[i].second;
+                if (sum % 3)
+                {
+                    matrix.rowIndex.push_back(row);
+                    matrix.values.push_back(static_cast<uint8_t>(sum % 3));
+                }
+            }
+            matrix.colStart.push_back(matrix.rowIndex.size());
+        }
+        return matrix;
+    }
+
+    size_t rows() const { return rowCount; }
+    size_t cols() const { return colCount; }
+    size_t nonZeros() const { return rowIndex.size(); }
+
+    size_t columnBegin(size_t col) const { return colStart[col]; }
+    size_t columnEnd(size_t col) const { return colStart[col + 1]; }
+    uint32_t row(size_t entry) const { return rowIndex[entry]; }
+    uint8_t value(size_t entry) const { return values[entry]; }
+};
+
+//================================================================================
+// Function: buildSparseEffectMatrix
+// Description:
+//     The toggle effect matrix straight from the toggle rule: column
+//     (y * width + x) has 1 on row y and column x of the grid, the center
+//     counted once.
+//================================================================================
+inline SparseGF3Matrix buildSparseEffectMatrix(uint32_t width, uint32_t height)
+{
+    size_t totalCells = static_cast<size_t>(width) * height;
+    return SparseGF3Matrix::fromColumns(totalCells, totalCells, [&](size_t toggle, auto emit) {
+        size_t toggleX = toggle % width, toggleY = toggle / width;
+        for (uint32_t y = 0; y < height; ++y)
+            if (y != toggleY)
+                emit(static_cast<size_t>(y) * width + toggleX, 1);
+        for (uint32_t x = 0; x < width; ++x)
+            emit(toggleY * width + x, 1);
+    });
+}
+
+//================================================================================
+// Function: buildSparseOperatorMatrix
+// Description:
+//     The effect matrix of any toggle operator (see toggle_operator.h),
+//     column c being apply() of the unit toggle vector e_c. n applications,
+//     for rules that have no direct builder.
+//================================================================================
+template <typename Operator>
+SparseGF3Matrix buildSparseOperatorMatrix(const Operator &op)
+{
+    size_t n = op.size();
+    std::vector<uint8_t> unit(n, 0), delta;
+    return SparseGF3Matrix::fromColumns(n, n, [&](size_t c, auto emit) {
+        unit[c] = 1;
+        op.apply(unit, delta);
+        unit[c] = 0;
+        for (size_t r = 0; r < n; ++r)
+            if (delta[r])
+                emit(r, delta[r]);
+    });
+}
+
+//================================================================================
+// Function: solveSparseLinearSystem
+// Description:
+//     Sparse Gaussian elimination with Markowitz pivoting. The active rows
+//     are kept as sorted (column, value) lists, so row updates only visit
+//     nonzeros. Every step picks, among the entries of the few shortest
+//     active rows, the pivot with the smallest Markowitz cost
+//     (row length - 1) · (column count - 1), i.e. the least possible fill,
+//     eliminates its column from the other active rows and freezes the
+//     pivot row. Back substitution runs over the frozen rows in reverse;
+//     free unknowns are 0.
+//================================================================================
+inline SolveResult solveSparseLinearSystem(const SparseGF3Matrix &matrix, const std::vector<int> &target)
+{
+    using Row = std::vector<std::pair<uint32_t, uint8_t>>;
+    constexpr size_t CANDIDATE_ROWS = 4;
+
+    size_t n = matrix.rows();
+    size_t m = matrix.cols();
+
+    // Transpose into rows
+    std::vector<Row> rows(n);
+    for (size_t c = 0; c < m; ++c)
+        for (size_t e = matrix.columnBegin(c); e < matrix.columnEnd(c); ++e)
+            rows[matrix.row(e)].emplace_back(static_cast<uint32_t>(c), matrix.value(e));
+
+    std::vector<uint8_t> rhs(n);
+    for (size_t i = 0; i < n; ++i)
+        rhs[i] = static_cast<uint8_t>(((target[i] % 3) + 3) % 3);
+
+    // Rows holding each column (may contain rows that lost the entry since,
+    // checked on use) and the exact number of active rows holding it
+    std::vector<std::vector<uint32_t>> columnRows(m);
+    std::vector<uint32_t> columnCount(m, 0);
+    for (size_t i = 0; i < n; ++i)
+        for (const auto &entry : rows[i])
+        {
+            columnRows[entry.first].push_back(static_cast<uint32_t>(i));
+            ++columnCount[entry.first];
+        }
+
+    std::vector<bool> active(n, true);
+    std::set<std::pair<size_t, uint32_t>> byLength; // (length, row) of active rows
+    for (size_t i = 0; i < n; ++i)
+        byLength.emplace(rows[i].size(), static_cast<uint32_t>(i));
+
+    auto valueAt = [](const Row &row, uint32_t col) -> uint8_t {
+        auto it = std::lower_bound(row.begin(), row.end(), std::make_pair(col, uint8_t(0)));
+        return (it != row.end() && it->first == col) ? it->second : 0;
+    };
+
+    bool consistent = true;
+    std::vector<std::pair<uint32_t, uint32_t>> pivots; // (row, column) in elimination order
+    Row merged;
+
+    while (!byLength.empty())
+    {
+        // Empty rows: either redundant or 0 = nonzero
+        auto shortest = byLength.begin();
+        if (shortest->first == 0)
+        {
+            uint32_t i = shortest->second;
+            byLength.erase(shortest);
+            active[i] = false;
+            if (rhs[i] != 0)
+                consistent = false; // keeps eliminating for rank and nullspace
+            continue;
+        }
+
+        // Markowitz search over the entries of the shortest rows
+        uint32_t pivotRow = 0, pivotCol = 0;
+        uint64_t bestCost = UINT64_MAX;
+        size_t examined = 0;
+        for (auto it = byLength.begin(); it != byLength.end() && examined < CANDIDATE_ROWS; ++it, ++examined)
+        {
+            for (const auto &entry : rows[it->second])
+            {
+                uint64_t cost = static_cast<uint64_t>(it->first - 1) * (columnCount[entry.first] - 1);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    pivotRow = it->second;
+                    pivotCol = entry.first;
+                }
+            }
+            if (bestCost == 0)
+                break;
+        }
+
+        const Row &pivot = rows[pivotRow];
+        uint8_t pivotValue = valueAt(pivot, pivotCol);
+        byLength.erase({pivot.size(), pivotRow});
+        active[pivotRow] = false;
+        for (const auto &entry : pivot)
+            --columnCount[entry.first];
+        pivots.emplace_back(pivotRow, pivotCol);
+
+        // row_i -= (a / p) · pivot for every other active row with a nonzero a in pivotCol
+        for (uint32_t i : columnRows[pivotCol])
+        {
+            if (!active[i])
+                continue;
+            uint8_t a = valueAt(rows[i], pivotCol);
+            if (a == 0)
+                continue;
+
+            uint8_t factor = (a * pivotValue) % 3; // p⁻¹ = p in GF(3)
+            uint8_t minusFactor = (3 - factor) % 3;
+            Row &target = rows[i];
+            byLength.erase({target.size(), i});
+
+            merged.clear();
+            size_t p = 0, q = 0;
+            while (p < target.size() || q < pivot.size())
+            {
+                if (q == pivot.size() || (p < target.size() && target[p].first < pivot[q].first))
+                {
+                    merged.push_back(target[p++]);
+                    continue;
+                }
+
+                uint32_t col = pivot[q].first;
+                uint8_t delta = (minusFactor * pivot[q].second) % 3;
+                ++q;
+                if (p < target.size() && target[p].first == col)
+                {
+                    uint8_t value = (target[p++].second + delta) % 3;
+                    if (value)
+                        merged.emplace_back(col, value);
+                    else
+                        --columnCount[col]; // cancelled
+                }
+                else
+                {
+                    merged.emplace_back(col, delta); // fill-in
+                    ++columnCount[col];
+                    columnRows[col].push_back(i);
+                }
+            }
+            target.swap(merged);
+            rhs[i] = (rhs[i] + minusFactor * rhs[pivotRow]) % 3;
+            byLength.emplace(target.size(), i);
+        }
+    }
+
+    // Back substitution: every frozen pivot row only refers to its own
+    // column and columns pivoted after it (or free ones, fixed beforehand)
+    auto substitute = [&](std::vector<int> &x, bool homogeneous) {
+        for (size_t k = pivots.size(); k-- > 0;)
+        {
+            const Row &row = rows[pivots[k].first];
+            uint32_t col = pivots[k].second;
+            int sum = homogeneous ? 0 : rhs[pivots[k].first];
+            uint8_t pivotValue = 0;
+            for (const auto &entry : row)
+            {
+                if (entry.first == col)
+                    pivotValue = entry.second;
+                else
+                    sum += 3 * 3 - entry.second * x[entry.first];
+            }
+            x[col] = (sum * pivotValue) % 3;
+        }
+    };
+
+    SolveResult result;
+    result.rank = static_cast<uint32_t>(pivots.size());
+    result.nullity = static_cast<uint32_t>(m - pivots.size());
+
+    // Kernel basis: one free unknown 1, the others 0, solved homogeneously
+    std::vector<bool> isPivot(m, false);
+    for (const auto &pivot : pivots)
+        isPivot[pivot.second] = true;
+    auto basis = std::make_shared<PackedGF3Matrix>(result.nullity, m);
+    std::vector<int> x;
+    for (size_t c = 0, k = 0; c < m; ++c)
+    {
+        if (isPivot[c])
+            continue;
+        x.assign(m, 0);
+        x[c] = 1;
+        substitute(x, true);
+        for (size_t j = 0; j < m; ++j)
+            if (x[j])
+                basis->set(k, j, x[j]);
+        ++k;
+    }
+    result.nullspace = basis;
+
+    if (!consistent)
+        return result;
+
+    result.solution.assign(m, 0);
+    substitute(result.solution, false);
+    result.solvable = true;
+    return result;
+}
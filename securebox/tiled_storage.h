@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "box_storage.h"
+
+//================================================================================
+// Class: TiledStorage
+// Description:
+//     Storage for very large boxes (up to 65536×65536). The grid is split into
+//     64×64 tiles, each tile is 64 bitsliced rows of one (ones, twos) word
+//     pair, 1 KiB per tile, tiles stored row-major. A toggle only touches the
+//     tiles along its row and its column: one word pair per tile for the row,
+//     one bit column per tile for the column.
+//
+//     Every tile remembers the change counter of its last modification, so
+//     a reader that keeps the generation() it last saw can ask
+//     forEachChangedTile() for the tiles it has not seen yet instead of
+//     re-reading the grid. The byte mirror behind view() does that and only
+//     decodes changed tiles.
+//================================================================================
+class TiledStorage
+{
+public:
+    static constexpr uint32_t TILE_SIZE = 64;
+
+private:
+    static constexpr size_t TILE_WORDS = 2 * TILE_SIZE; // per tile row: ones word, twos word
+
+    std::vector<uint64_t> words;
+    uint32_t xSize = 0, ySize = 0;
+    uint32_t tilesX = 0, tilesY = 0;
+    uint64_t lastColumnMask = 0; // valid bits of a row in the rightmost tile column
+    CellHistogram counts;
+
+    std::vector<uint64_t> tileVersion; // changeCount at the last change of every tile
+    uint64_t changeCount = 0;
+
+    mutable std::vector<uint8_t> mirror;
+    mutable uint64_t mirrorVersion = 0;
+
+    uint64_t *tile(uint32_t tx, uint32_t ty) { return &words[(static_cast<size_t>(ty) * tilesX + tx) * TILE_WORDS]; }
+    const uint64_t *tile(uint32_t tx, uint32_t ty) const { return &words[(static_cast<size_t>(ty) * tilesX + tx) * TILE_WORDS]; }
+
+    uint64_t columnMask(uint32_t tx) const { return tx + 1 == tilesX ? lastColumnMask : ~uint64_t(0); }
+    uint32_t rowsIn(uint32_t ty) const { return std::min(TILE_SIZE, ySize - ty * TILE_SIZE); }
+
+    void touch(uint32_t tx, uint32_t ty, uint64_t version)
+    {
+        tileVersion[static_cast<size_t>(ty) * tilesX + tx] = version;
+    }
+
+public:
+    static const char *name() { return "tiled"; }
+
+    void resize(uint32_t width, uint32_t height)
+    {
+        xSize = width;
+        ySize = height;
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        uint32_t tail = width % TILE_SIZE;
+        lastColumnMask = tail ? (uint64_t(1) << tail) - 1 : ~uint64_t(0);
+        words.assign(static_cast<size_t>(tilesX) * tilesY * TILE_WORDS, 0);
+        counts.reset(static_cast<uint64_t>(width) * height);
+
+        // Every tile starts out changed, so new consumers read the whole grid once
+        changeCount = 1;
+        tileVersion.assign(static_cast<size_t>(tilesX) * tilesY, changeCount);
+        mirror.clear();
+        mirrorVersion = 0;
+    }
+
+    uint8_t get(uint32_t x, uint32_t y) const
+    {
+        const uint64_t *row = tile(x / TILE_SIZE, y / TILE_SIZE) + 2 * (y % TILE_SIZE);
+        uint64_t bit = uint64_t(1) << (x % TILE_SIZE);
+        if (row[0] & bit)
+            return 1;
+        return (row[1] & bit) ? 2 : 0;
+    }
+
+    void incrementRow(uint32_t y)
+    {
+        uint64_t version = ++changeCount;
+        uint32_t ty = y / TILE_SIZE;
+        size_t offset = 2 * (y % TILE_SIZE);
+        TritCount before;
+        for (uint32_t tx = 0; tx < tilesX; ++tx)
+        {
+            uint64_t *row = tile(tx, ty) + offset;
+            uint64_t one = row[0], two = row[1];
+            before.ones += gf3::popCount(one);
+            before.twos += gf3::popCount(two);
+            row[0] = ~(one | two) & columnMask(tx);
+            row[1] = one;
+            touch(tx, ty, version);
+        }
+        counts.rotate(before, xSize);
+    }
+
+    void incrementColumn(uint32_t x)
+    {
+        uint64_t version = ++changeCount;
+        uint32_t tx = x / TILE_SIZE;
+        uint64_t bit = uint64_t(1) << (x % TILE_SIZE);
+        TritCount before;
+        for (uint32_t ty = 0; ty < tilesY; ++ty)
+        {
+            uint64_t *rows = tile(tx, ty);
+            before += toggleKernels.incrementBitColumn(rows, rows + 1, 2, rowsIn(ty), bit);
+            touch(tx, ty, version);
+        }
+        counts.rotate(before, ySize);
+    }
+
+    void increment(uint32_t x, uint32_t y, uint8_t amount)
+    {
+        uint8_t value = get(x, y);
+        uint8_t next = (value + amount) % 3;
+        if (next == value)
+            return;
+
+        uint64_t *row = tile(x / TILE_SIZE, y / TILE_SIZE) + 2 * (y % TILE_SIZE);
+        uint64_t bit = uint64_t(1) << (x % TILE_SIZE);
+        row[0] = (row[0] & ~bit) | (next == 1 ? bit : 0);
+        row[1] = (row[1] & ~bit) | (next == 2 ? bit : 0);
+        counts.change(value, next);
+        touch(x / TILE_SIZE, y / TILE_SIZE, ++changeCount);
+    }
+
+    void addOffsets(const uint8_t *rowOffset, const uint8_t *colOffset)
+    {
+        uint64_t version = ++changeCount;
+
+        // Column offsets as one word pair per tile column, for every possible row offset
+        std::vector<uint64_t> colOnes[3], colTwos[3];
+        for (int r = 0; r < 3; ++r)
+        {
+            colOnes[r].assign(tilesX, 0);
+            colTwos[r].assign(tilesX, 0);
+            for (uint32_t x = 0; x < xSize; ++x)
+            {
+                int v = (colOffset[x] + r) % 3;
+                uint64_t bit = uint64_t(1) << (x % TILE_SIZE);
+                if (v == 1)
+                    colOnes[r][x / TILE_SIZE] |= bit;
+                else if (v == 2)
+                    colTwos[r][x / TILE_SIZE] |= bit;
+            }
+        }
+
+        TritCount after;
+        for (uint32_t ty = 0; ty < tilesY; ++ty)
+        {
+            uint32_t rows = rowsIn(ty);
+            for (uint32_t tx = 0; tx < tilesX; ++tx)
+            {
+                uint64_t *t = tile(tx, ty);
+                for (uint32_t r = 0; r < rows; ++r)
+                {
+                    uint8_t offset = rowOffset[ty * TILE_SIZE + r] % 3;
+                    uint64_t &one = t[2 * r], &two = t[2 * r + 1];
+                    gf3::add(one, two, colOnes[offset][tx], colTwos[offset][tx], one, two);
+                    after.ones += gf3::popCount(one);
+                    after.twos += gf3::popCount(two);
+                }
+                touch(tx, ty, version);
+            }
+        }
+        counts.assign(static_cast<uint64_t>(xSize) * ySize, after);
+    }
+
+    bool anyNonZero() const
+    {
+        return counts.nonZero() != 0;
+    }
+
+    std::array<uint64_t, 3> histogram() const
+    {
+        return counts.values();
+    }
+
+    //================================================================================
+    // Method: view
+    // Description:
+    //     Byte view of the whole grid. The mirror holds W·H bytes, so on the
+    //     largest boxes prefer get() or forEachChangedTile(); only tiles that
+    //     changed since the previous call are decoded.
+    //================================================================================
+    StateView view() const
+    {
+        size_t cells = static_cast<size_t>(xSize) * ySize;
+        if (mirror.size() != cells)
+        {
+            mirror.assign(cells, 0);
+            mirrorVersion = 0;
+        }
+
+        forEachChangedTile(mirrorVersion, [this](uint32_t tx, uint32_t ty) {
+            uint32_t x0 = tx * TILE_SIZE, y0 = ty * TILE_SIZE;
+            uint32_t columns = std::min(TILE_SIZE, xSize - x0);
+            const uint64_t *t = tile(tx, ty);
+            for (uint32_t r = 0; r < rowsIn(ty); ++r)
+            {
+                uint8_t *out = &mirror[static_cast<size_t>(y0 + r) * xSize + x0];
+                for (uint32_t c = 0; c < columns; ++c)
+                    out[c] = ((t[2 * r] >> c) & 1) | (((t[2 * r + 1] >> c) & 1) << 1);
+            }
+        });
+        mirrorVersion = changeCount;
+
+        return StateView(mirror.data(), xSize, xSize, ySize);
+    }
+
+    void lineSums(uint8_t *rowSum, uint8_t *colSum) const
+    {
+        std::vector<uint32_t> rows(ySize, 0), columns(xSize, 0);
+        for (uint32_t ty = 0; ty < tilesY; ++ty)
+        {
+            for (uint32_t tx = 0; tx < tilesX; ++tx)
+            {
+                const uint64_t *t = tile(tx, ty);
+                uint32_t *column = &columns[tx * TILE_SIZE];
+                for (uint32_t r = 0; r < rowsIn(ty); ++r)
+                {
+                    uint64_t one = t[2 * r], two = t[2 * r + 1];
+                    rows[ty * TILE_SIZE + r] += gf3::popCount(one) + 2 * gf3::popCount(two);
+                    for (; one; one &= one - 1)
+                        column[gf3::countTrailingZeros(one)] += 1;
+                    for (; two; two &= two - 1)
+                        column[gf3::countTrailingZeros(two)] += 2;
+                }
+            }
+        }
+        for (uint32_t y = 0; y < ySize; ++y)
+            rowSum[y] = rows[y] % 3;
+        for (uint32_t x = 0; x < xSize; ++x)
+            colSum[x] = columns[x] % 3;
+    }
+
+    void flush() {}
+
+    //================================================================================
+    // Method: generation / forEachChangedTile
+    // Description:
+    //     generation() is a counter bumped by every change. forEachChangedTile
+    //     calls f(tx, ty) for every tile modified after generation since; tile
+    //     (tx, ty) covers x in [tx·64, tx·64 + 64) and y in [ty·64, ty·64 + 64),
+    //     clipped to the grid. A consumer passes 0 the first time.
+    //================================================================================
+    uint64_t generation() const { return changeCount; }
+
+    template <typename F>
+    void forEachChangedTile(uint64_t since, F f) const
+    {
+        for (uint32_t ty = 0; ty < tilesY; ++ty)
+            for (uint32_t tx = 0; tx < tilesX; ++tx)
+                if (tileVersion[static_cast<size_t>(ty) * tilesX + tx] > since)
+                    f(tx, ty);
+    }
+
+    uint32_t tileColumns() const { return tilesX; }
+    uint32_t tileRows() const { return tilesY; }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//================================================================================
+// Toggle operators
+//================================================================================
+// Matrix-free form of the effect matrix: apply(toggles, delta) writes into
+// delta how much every cell changes (mod 3) when toggle i is applied
+// toggles[i] times. Vectors are row-major (y * width + x) with values 0..2.
+// Every operator provides:
+//
+//     size_t size() const                                     → W·H
+//     void   apply(const std::vector<uint8_t> &toggles,
+//                  std::vector<uint8_t> &delta) const         → delta = A · toggles
+//
+// Krylov solvers (wiedemann_solver.h) only ever see this interface, so they
+// work for any toggle rule, including ones without a closed form.
+//================================================================================
+
+//================================================================================
+// Class: RowColumnToggleOperator
+// Description:
+//     The SecureBox rule: toggle(x, y) adds 1 to row y and column x, the
+//     center once. Evaluated like SecureBox::applyMoves, through row and
+//     column totals, so one apply() is O(W·H):
+//         delta[y][x] = R[y] + C[x] - t[y][x]
+//================================================================================
+class RowColumnToggleOperator
+{
+private:
+    uint32_t xSize, ySize;
+
+public:
+    RowColumnToggleOperator(uint32_t width, uint32_t height) : xSize(width), ySize(height) {}
+
+    size_t size() const { return static_cast<size_t>(xSize) * ySize; }
+    uint32_t width() const { return xSize; }
+    uint32_t height() const { return ySize; }
+
+    void apply(const std::vector<uint8_t> &toggles, std::vector<uint8_t> &delta) const
+    {
+        std::vector<uint32_t> rowTotal(ySize, 0), colTotal(xSize, 0);
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            const uint8_t *row = &toggles[static_cast<size_t>(y) * xSize];
+            for (uint32_t x = 0; x < xSize; ++x)
+            {
+                rowTotal[y] += row[x];
+                colTotal[x] += row[x];
+            }
+        }
+
+        delta.resize(size());
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            const uint8_t *row = &toggles[static_cast<size_t>(y) * xSize];
+            uint8_t *out = &delta[static_cast<size_t>(y) * xSize];
+            for (uint32_t x = 0; x < xSize; ++x)
+                out[x] = (rowTotal[y] + colTotal[x] + 2 * row[x]) % 3; // -t = +2t
+        }
+    }
+};
+
+//================================================================================
+// Class: StencilToggleOperator
+// Description:
+//     Toggle rule given as a list of (dx, dy, amount) entries: toggle(x, y)
+//     adds amount to cell (x + dx, y + dy) when it lies inside the grid, e.g.
+//     the Lights Out plus shape {(0,0,1), (1,0,1), (-1,0,1), (0,1,1), (0,-1,1)}.
+//     apply() is O(W·H·entries), the rule needs no closed form.
+//================================================================================
+class StencilToggleOperator
+{
+public:
+    struct Entry
+    {
+        int dx, dy;
+        uint8_t amount;
+    };
+
+private:
+    uint32_t xSize, ySize;
+    std::vector<Entry> stencil;
+
+public:
+    StencilToggleOperator(uint32_t width, uint32_t height, std::vector<Entry> entries)
+        : xSize(width), ySize(height), stencil(std::move(entries))
+    {
+    }
+
+    size_t size() const { return static_cast<size_t>(xSize) * ySize; }
+    size_t entries() const { return stencil.size(); }
+    const std::vector<Entry> &pattern() const { return stencil; }
+
+    void apply(const std::vector<uint8_t> &toggles, std::vector<uint8_t> &delta) const
+    {
+        delta.assign(size(), 0);
+        for (uint32_t y = 0; y < ySize; ++y)
+        {
+            for (uint32_t x = 0; x < xSize; ++x)
+            {
+                uint8_t times = toggles[static_cast<size_t>(y) * xSize + x];
+                if (!times)
+                    continue;
+                for (const Entry &entry : stencil)
+                {
+                    int64_t cx = static_cast<int64_t>(x) + entry.dx;
+                    int64_t cy = static_cast<int64_t>(y) + entry.dy;
+                    if (cx < 0 || cy < 0 || cx >= xSize || cy >= ySize)
+                        continue;
+                    uint8_t &cell = delta[static_cast<size_t>(cy) * xSize + static_cast<size_t>(cx)];
+                    cell = (cell + times * entry.amount) % 3;
+                }
+            }
+        }
+    }
+};
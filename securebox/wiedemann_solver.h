@@ -0,0 +1,320 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "solve_result.h"
+#include "toggle_operator.h"
+
+//================================================================================
+// Wiedemann solver
+//================================================================================
+// Solves A x = b over GF(3) with A only available as a toggle operator (see
+// toggle_operator.h). For a random projection u the scalar sequence
+//
+//     s_i = u · A^i b,    i < 2n
+//
+// is linearly generated by the minimal polynomial f of b under A, and
+// Berlekamp-Massey recovers f from it. With f(λ) = f_0 + f_1 λ + ... + f_L λ^L
+// and f_0 ≠ 0, f(A) b = 0 rearranges to
+//
+//     x = -f_0⁻¹ · (f_1 b + f_2 A b + ... + f_L A^(L-1) b)
+//
+// That is 2n + L ≤ 3n operator applications and O(n) memory; for the
+// row/column rule (apply = O(W·H)) the whole solve is O(n²).
+//
+// Over GF(3) a single projection misses a factor of f with probability about
+// 1/3, so every round runs a few projections over the same Krylov vectors
+// and takes the lcm of their polynomials. Each round verifies its answer and
+// recurses on the residual r = b - A x with a fresh projection and a fresh
+// random diagonal preconditioner D (solving A D y = r, x += D y).
+//
+// Only nonsingular operators are supported. A singular one can put a λ
+// factor into f, and when b has a component in a nilpotent block of index
+// > 1 the solution need not lie in any Krylov space the rounds see (row/
+// column boxes like 4×9 or 13×9 fail for about half of their reachable
+// targets). Handling that needs the Kaltofen-Saunders preconditioners; the
+// registry instead only offers this solver for boxes with
+// closedFormNullity(W, H) == 0, and everything singular goes to an
+// elimination.
+//================================================================================
+
+namespace wiedemann_detail
+{
+    constexpr size_t PROJECTIONS = 4;
+
+    inline uint8_t inverse3(uint8_t v)
+    {
+        return v; // 1·1 = 1, 2·2 = 4 = 1
+    }
+
+    inline uint8_t dot(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+            sum += a[i] * b[i];
+        return static_cast<uint8_t>(sum % 3);
+    }
+
+    // target += factor * source
+    inline void addScaled(std::vector<uint8_t> &target, const std::vector<uint8_t> &source, uint8_t factor)
+    {
+        if (factor == 0)
+            return;
+        for (size_t i = 0; i < target.size(); ++i)
+            target[i] = (target[i] + factor * source[i]) % 3;
+    }
+
+    inline bool isZero(const std::vector<uint8_t> &v)
+    {
+        for (uint8_t value : v)
+            if (value)
+                return false;
+        return true;
+    }
+
+    //================================================================================
+    // Function: berlekampMassey
+    // Description:
+    //     Shortest connection polynomial C (C[0] = 1) of the sequence over
+    //     GF(3): s[j] + C[1] s[j-1] + ... + C[L] s[j-L] = 0 for all j >= L.
+    //     The minimal polynomial is its reversal, f_k = C[L - k].
+    //================================================================================
+    inline std::vector<uint8_t> berlekampMassey(const std::vector<uint8_t> &s)
+    {
+        std::vector<uint8_t> C{1}, B{1};
+        size_t L = 0, shift = 1;
+        uint8_t lastDiscrepancy = 1;
+
+        for (size_t j = 0; j < s.size(); ++j)
+        {
+            uint32_t d = s[j];
+            for (size_t i = 1; i <= L && i < C.size(); ++i)
+                d += C[i] * s[j - i];
+            uint8_t discrepancy = d % 3;
+
+            if (discrepancy == 0)
+            {
+                ++shift;
+                continue;
+            }
+
+            // C -= (d / b) λ^shift B
+            uint8_t factor = (discrepancy * inverse3(lastDiscrepancy)) % 3;
+            std::vector<uint8_t> previous = C;
+            if (C.size() < B.size() + shift)
+                C.resize(B.size() + shift, 0);
+            for (size_t i = 0; i < B.size(); ++i)
+                C[i + shift] = (C[i + shift] + 3 - (factor * B[i]) % 3) % 3;
+
+            if (2 * L <= j)
+            {
+                L = j + 1 - L;
+                B = previous;
+                lastDiscrepancy = discrepancy;
+                shift = 1;
+            }
+            else
+                ++shift;
+        }
+
+        C.resize(L + 1, 0);
+        return C;
+    }
+
+    //================================================================================
+    // Polynomials over GF(3), coefficient k of λ^k at index k, no trailing zeros
+    //================================================================================
+    inline void trim(std::vector<uint8_t> &p)
+    {
+        while (!p.empty() && p.back() == 0)
+            p.pop_back();
+    }
+
+    inline std::vector<uint8_t> multiply(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+    {
+        if (a.empty() || b.empty())
+            return {};
+        std::vector<uint8_t> product(a.size() + b.size() - 1, 0);
+        for (size_t i = 0; i < a.size(); ++i)
+            for (size_t j = 0; j < b.size(); ++j)
+                product[i + j] = (product[i + j] + a[i] * b[j]) % 3;
+        return product;
+    }
+
+    // Returns a / b and leaves a % b in a
+    inline std::vector<uint8_t> divide(std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+    {
+        trim(a);
+        if (a.size() < b.size())
+            return {};
+        std::vector<uint8_t> quotient(a.size() - b.size() + 1, 0);
+        uint8_t leadInverse = inverse3(b.back());
+        for (size_t k = quotient.size(); k-- > 0;)
+        {
+            uint8_t q = (a[k + b.size() - 1] * leadInverse) % 3;
+            quotient[k] = q;
+            for (size_t i = 0; i < b.size(); ++i)
+                a[k + i] = (a[k + i] + 3 - (q * b[i]) % 3) % 3;
+        }
+        trim(a);
+        return quotient;
+    }
+
+    inline std::vector<uint8_t> lcm(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b)
+    {
+        std::vector<uint8_t> x = a, y = b;
+        while (!y.empty())
+        {
+            divide(x, y);
+            x.swap(y);
+        }
+        std::vector<uint8_t> product = multiply(a, b);
+        return divide(product, x);
+    }
+
+    //================================================================================
+    // Function: round
+    // Description:
+    //     One Wiedemann pass for A D y = b with D = diag(scale). Returns y, or
+    //     an empty vector when the recovered polynomial has no usable constant
+    //     term.
+    //================================================================================
+    template <typename Operator>
+    std::vector<uint8_t> round(const Operator &op, const std::vector<uint8_t> &scale, const std::vector<uint8_t> &b,
+                               std::mt19937_64 &rng)
+    {
+        size_t n = op.size();
+
+        auto applyScaled = [&](const std::vector<uint8_t> &in, std::vector<uint8_t> &out, std::vector<uint8_t> &scratch) {
+            scratch.resize(n);
+            for (size_t i = 0; i < n; ++i)
+                scratch[i] = (in[i] * scale[i]) % 3;
+            op.apply(scratch, out);
+        };
+
+        // s_i = u_j · (A D)^i b for PROJECTIONS vectors u_j, all from one Krylov pass
+        std::vector<std::vector<uint8_t>> u(PROJECTIONS, std::vector<uint8_t>(n));
+        for (auto &projection : u)
+            for (auto &value : projection)
+                value = static_cast<uint8_t>(rng() % 3);
+
+        std::vector<std::vector<uint8_t>> sequences(PROJECTIONS, std::vector<uint8_t>(2 * n));
+        std::vector<uint8_t> v = b, next, scratch;
+        for (size_t i = 0; i < 2 * n; ++i)
+        {
+            for (size_t j = 0; j < PROJECTIONS; ++j)
+                sequences[j][i] = dot(u[j], v);
+            if (i + 1 < 2 * n)
+            {
+                applyScaled(v, next, scratch);
+                v.swap(next);
+            }
+        }
+
+        // Every projection yields a divisor of the minimal polynomial, their lcm
+        // misses a factor with probability about 3^-PROJECTIONS
+        std::vector<uint8_t> f{1};
+        for (const auto &sequence : sequences)
+        {
+            std::vector<uint8_t> C = berlekampMassey(sequence);
+            f = lcm(f, std::vector<uint8_t>(C.rbegin(), C.rend()));
+        }
+        size_t L = f.size() - 1;
+
+        // Drop λ factors, they only add kernel components
+        size_t low = 0;
+        while (low < L && f[low] == 0)
+            ++low;
+        if (low == L)
+            return {};
+
+        uint8_t minusInverse = (3 - inverse3(f[low])) % 3;
+
+        // y = -f0⁻¹ Σ_{k>=1} f_k (A D)^(k-1) b, shifted down by the dropped λ^low
+        std::vector<uint8_t> y(n, 0);
+        v = b;
+        for (size_t k = low + 1; k <= L; ++k)
+        {
+            addScaled(y, v, (minusInverse * f[k]) % 3);
+            if (k < L)
+            {
+                applyScaled(v, next, scratch);
+                v.swap(next);
+            }
+        }
+        return y;
+    }
+}
+
+//================================================================================
+// Struct: WiedemannReport
+// Description:
+//     How solveWiedemann got its answer: the Wiedemann rounds it ran and
+//     whether the last one left a zero residual.
+//================================================================================
+struct WiedemannReport
+{
+    int rounds = 0;
+    bool converged = false;
+};
+
+//================================================================================
+// Function: solveWiedemann
+// Description:
+//     Matrix-free solve of A x = target for a nonsingular toggle operator.
+//     Runs up to rounds Wiedemann passes on the residual; each one fails
+//     with probability about 3^-PROJECTIONS, so running out of rounds is
+//     reported as not solvable (and not converged in report, if given)
+//     rather than expected. Singular operators are not supported, see the
+//     top of this file. Rank and nullity are left 0 (unknown).
+//================================================================================
+template <typename Operator>
+SolveResult solveWiedemann(const Operator &op, const std::vector<int> &target, uint64_t seed = 0x5eedb0c5,
+                           int rounds = 12, WiedemannReport *report = nullptr)
+{
+    using namespace wiedemann_detail;
+
+    size_t n = op.size();
+    std::mt19937_64 rng(seed);
+
+    std::vector<uint8_t> b(n);
+    for (size_t i = 0; i < n; ++i)
+        b[i] = static_cast<uint8_t>(((target[i] % 3) + 3) % 3);
+
+    std::vector<uint8_t> x(n, 0), residual = b, applied;
+    std::vector<uint8_t> scale(n, 1);
+
+    SolveResult result;
+    int attempt = 0;
+    for (; attempt < rounds && !isZero(residual); ++attempt)
+    {
+        // The first round runs unpreconditioned, later ones with random D
+        if (attempt > 0)
+            for (auto &value : scale)
+                value = static_cast<uint8_t>(1 + rng() % 2);
+
+        std::vector<uint8_t> y = round(op, scale, residual, rng);
+        if (y.empty())
+            continue;
+
+        for (size_t i = 0; i < n; ++i)
+            x[i] = (x[i] + y[i] * scale[i]) % 3;
+
+        op.apply(x, applied);
+        for (size_t i = 0; i < n; ++i)
+            residual[i] = (b[i] + 3 - applied[i]) % 3;
+    }
+
+    bool converged = isZero(residual);
+    if (report)
+        *report = {attempt, converged};
+    if (!converged)
+        return result;
+
+    result.solvable = true;
+    result.solution.assign(x.begin(), x.end());
+    return result;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//================================================================================
+// Class: WorkerPool
+// Description:
+//     Fixed set of threads for fork-join loops. run(job) calls job(worker)
+//     once on every worker, the calling thread being worker 0, and returns
+//     when all of them finished, so every run() is also a barrier. Threads
+//     are started once and sleep on a condition variable between runs.
+//================================================================================
+class WorkerPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake, finished;
+    const std::function<void(unsigned)> *job = nullptr;
+    uint64_t round = 0;
+    size_t running = 0;
+    bool stopping = false;
+
+    void work(unsigned index)
+    {
+        uint64_t seen = 0;
+        for (;;)
+        {
+            const std::function<void(unsigned)> *current;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || round != seen; });
+                if (stopping)
+                    return;
+                seen = round;
+                current = job;
+            }
+
+            (*current)(index);
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (--running == 0)
+                finished.notify_one();
+        }
+    }
+
+public:
+    //================================================================================
+    // Constructor: WorkerPool
+    // Description:
+    //     threads = 0 uses one worker per hardware thread.
+    //================================================================================
+    explicit WorkerPool(unsigned threads = 0)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 1; i < threads; ++i)
+            workers.emplace_back(&WorkerPool::work, this, i);
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(workers.size() + 1);
+    }
+
+    void run(const std::function<void(unsigned)> &task)
+    {
+        if (workers.empty())
+        {
+            task(0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            job = &task;
+            running = workers.size();
+            ++round;
+        }
+        wake.notify_all();
+
+        task(0);
+
+        std::unique_lock<std::mutex> guard(lock);
+        finished.wait(guard, [&] { return running == 0; });
+    }
+
+    //================================================================================
+    // Method: range
+    // Description:
+    //     Static split of [0, count) into size() contiguous slices, returns the
+    //     [begin, end) slice of one worker.
+    //================================================================================
+    std::pair<size_t, size_t> range(size_t count, unsigned worker) const
+    {
+        size_t parts = size();
+        return {count * worker / parts, count * (worker + 1) / parts};
+    }
+};